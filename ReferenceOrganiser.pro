@@ -5,10 +5,18 @@
 #-------------------------------------------------
 
 CONFIG   += c++11
-QT       += core gui xml
+QT       += core gui xml concurrent sql
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+# Compressed databases use the system's zlib where Qt does, otherwise the zlib built into
+# Qt; its headers come with the private modules, e.g. the qtbase-private-dev package
+qtConfig(system-zlib) {
+    LIBS += -lz
+} else {
+    QT   += core-private zlib-private
+}
+
 
 TARGET = ReferenceOrganiser
 TEMPLATE = app
@@ -17,38 +25,63 @@ TEMPLATE = app
 SOURCES += main.cpp \
     addpaperdialog.cpp \
     createdatabasedialog.cpp \
+    databasecache.cpp \
     databasefilereader.cpp \
     databasefilewriter.cpp \
     databasehandler.cpp \
+    databasejournal.cpp \
     databasenamedialog.cpp \
     duplicatesviewer.cpp \
     history.cpp \
+    memoryreport.cpp \
     metadialog.cpp \
     organisermain.cpp \
+    performancelog.cpp \
     settingsdialog.cpp \
     searchdialog.cpp \
+    searchquery.cpp \
     reviewparser.cpp \
     busyindicator.cpp \
-    reviewscanner.cpp
+    reviewscanner.cpp \
+    gzipdevice.cpp \
+    sqlitestorage.cpp \
+    stringarena.cpp \
+    stringpool.cpp \
+    tagdictionary.cpp \
+    textindex.cpp \
+    xmlstorage.cpp
 
 
 HEADERS  += organisermain.h \
     addpaperdialog.h \
     createdatabasedialog.h \
+    databasecache.h \
     databasefilereader.h \
     databasefilewriter.h \
     databasehandler.h \
+    databasejournal.h \
     databasenamedialog.h \
     duplicatesviewer.h \
     history.h \
+    memoryreport.h \
     metadialog.h \
+    performancelog.h \
     settingsdialog.h \
     searchdialog.h \
+    searchquery.h \
     reviewparser.h \
     busyindicator.h \
     reviewscanner.h \
     recordlistitem.h \
-    papermeta.h
+    gzipdevice.h \
+    papermeta.h \
+    sqlitestorage.h \
+    storagebackend.h \
+    stringarena.h \
+    stringpool.h \
+    tagdictionary.h \
+    textindex.h \
+    xmlstorage.h
 
 FORMS    += organisermain.ui \
     addpaper.ui \
@@ -0,0 +1,129 @@
+/**
+ * @file   parsebench.cpp
+ * @brief  Throughput of reading database files
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include <iostream>
+#include <functional>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QThread>
+#include <QXmlStreamReader>
+
+#include "syntheticdatabase.h"
+#include "databasefilereader.h"
+#include "databasefilewriter.h"
+#include "xmlstorage.h"
+
+/// Times each pass is run; the fastest is reported
+#define BENCH_REPEATS 3
+
+// Best time in milliseconds of a pass, which returns the number of records it read
+static void runPass(const char *label, qint64 bytes, const std::function<int()> &pass)
+{
+  qint64 best = -1;
+  int records = 0;
+  for(int r = 0; r < BENCH_REPEATS; r++)
+  {
+    QElapsedTimer timer;
+    timer.start();
+    records = pass();
+    qint64 elapsed = timer.nsecsElapsed();
+    if((best < 0) || (elapsed < best)) best = elapsed;
+  }
+
+  double seconds = best/1e9;
+  std::cout << label << ": " << records << " records in " << best/1000000 << " ms, "
+            << (bytes/1024.0/1024.0)/seconds << " MB/s\n";
+}
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+
+  int count = (argc > 1) ? atoi(argv[1]) : 20000;
+
+  QTemporaryDir dir;
+  QString filename = dir.filePath("bench.rodb");
+
+  DatabaseFileWriter writer;
+  if(!writer.Save(filename, "Benchmark", SyntheticRecords(count)))
+  {
+    std::cerr << "Could not write " << filename.toStdString() << "\n";
+    return(1);
+  }
+
+  QFile file(filename);
+  if(!file.open(QIODevice::ReadOnly)) return(1);
+  qint64 bytes = file.size();
+  QByteArray contents = file.readAll();
+  const char *data = reinterpret_cast<const char *>(file.map(0, bytes));
+  if(!data) return(1);
+
+  std::cout << count << " synthetic records, " << bytes/1024/1024 << " MB\n";
+
+  // Lower bound: the XML is tokenized and nothing is kept
+  runPass("Tokenize only", bytes, [&contents]()
+  {
+    QXmlStreamReader reader(contents);
+    int records = 0;
+    while(!reader.atEnd())
+    {
+      if((reader.readNext() == QXmlStreamReader::StartElement) && (reader.name() == QLatin1String("record"))) records++;
+    }
+    return(records);
+  });
+
+  // Tokenized with a string made for each element name, as element dispatch used to do
+  runPass("Tokenize, element names as strings", bytes, [&contents]()
+  {
+    QXmlStreamReader reader(contents);
+    int records = 0;
+    while(!reader.atEnd())
+    {
+      if(reader.readNext() != QXmlStreamReader::StartElement) continue;
+
+      QString element = reader.name().toString();
+      if(element == QLatin1String("record")) records++;
+    }
+    return(records);
+  });
+
+  runPass("Stream reader", bytes, [&filename]()
+  {
+    QFile input(filename);
+    input.open(QIODevice::ReadOnly);
+
+    QString name;
+    QVector<PaperMeta> records;
+    DatabaseFileReader reader;
+    reader.Read(&input, name, &records);
+    return(records.size());
+  });
+
+  runPass("Mapped reader", bytes, [data, bytes]()
+  {
+    QString name;
+    QVector<PaperMeta> records;
+    DatabaseFileReader reader;
+    reader.ReadMapped(data, bytes, name, &records);
+    return(records.size());
+  });
+
+  int shards = QThread::idealThreadCount()*PARALLEL_LOAD_SHARDS_PER_THREAD;
+  runPass("Mapped reader, parallel", bytes, [data, bytes, shards]()
+  {
+    QString name;
+    QVector<PaperMeta> records;
+    DatabaseFileReader reader;
+    reader.ReadMappedParallel(data, bytes, name, &records, shards);
+    return(records.size());
+  });
+
+  return(0);
+}
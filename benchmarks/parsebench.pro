@@ -0,0 +1,35 @@
+#-------------------------------------------------
+#
+# Throughput of reading database files
+#
+# qmake parsebench.pro && make && ./parsebench [records]
+#
+#-------------------------------------------------
+
+CONFIG   += c++11 console
+CONFIG   -= app_bundle
+QT       += core xml concurrent
+QT       -= gui
+
+# Compressed databases use the system's zlib where Qt does, otherwise the zlib built into
+# Qt; its headers come with the private modules, e.g. the qtbase-private-dev package
+qtConfig(system-zlib) {
+    LIBS += -lz
+} else {
+    QT   += core-private zlib-private
+}
+
+TARGET = parsebench
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+SOURCES += parsebench.cpp \
+    syntheticdatabase.cpp \
+    ../databasefilereader.cpp \
+    ../databasefilewriter.cpp \
+    ../databasejournal.cpp \
+    ../gzipdevice.cpp \
+    ../stringarena.cpp
+
+HEADERS += syntheticdatabase.h
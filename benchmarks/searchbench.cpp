@@ -0,0 +1,141 @@
+/**
+ * @file   searchbench.cpp
+ * @brief  Time of searches over a synthetic database
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include <iostream>
+#include <functional>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+
+#include "syntheticdatabase.h"
+#include "searchdialog.h"
+#include "textindex.h"
+
+/// Times each search is run; the fastest is reported
+#define BENCH_REPEATS 3
+
+// Best time of a search, which returns the number of results
+static void runSearch(const char *label, const std::function<int()> &search)
+{
+  qint64 best = -1;
+  int results = 0;
+  for(int r = 0; r < BENCH_REPEATS; r++)
+  {
+    QElapsedTimer timer;
+    timer.start();
+    results = search();
+    qint64 elapsed = timer.nsecsElapsed();
+    if((best < 0) || (elapsed < best)) best = elapsed;
+  }
+
+  std::cout << label << ": " << results << " results in " << best/1000 << " us\n";
+}
+
+// Results of a search by the searcher
+static int searchWith(const QVector<PaperMeta> &records, const TextIndex *title, const TextIndex *review,
+                      const std::function<void(Searcher &)> &setup)
+{
+  Searcher searcher;
+  searcher.SetData(&records);
+  searcher.SetWordIndexes(title, review);
+  searcher.SetHaltFlag(QSharedPointer<std::atomic<bool>>::create(false));
+  setup(searcher);
+
+  int results = 0;
+  QObject::connect(&searcher, &Searcher::result, [&results](const QVector<int> &indexes) { results += indexes.size(); });
+  searcher.process();
+
+  return(results);
+}
+
+// Results of the search as it was run before plans were compiled: the expressions are
+// built for every record and the tests run in a fixed order
+static int searchPerRecord(const QVector<PaperMeta> &records, const QString &keywords, const QString &authors,
+                           int year_start, int year_stop)
+{
+  int results = 0;
+  for(int r = 0; r < records.size(); r++)
+  {
+    const PaperMeta &record = records[r];
+
+    QRegularExpression keyword_regexp(QString("\\b(%1)\\b").arg(keywords.split(' ').join('|')),
+                                      QRegularExpression::CaseInsensitiveOption);
+    if(!record.title.contains(keyword_regexp) && !record.review.contains(keyword_regexp)) continue;
+
+    QRegularExpression author_regexp(QString("\\b(%1)\\b").arg(authors), QRegularExpression::CaseInsensitiveOption);
+    if(!record.authors.contains(author_regexp)) continue;
+
+    int year = record.year.toInt();
+    if((year < year_start) || (year > year_stop)) continue;
+
+    results++;
+  }
+
+  return(results);
+}
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+
+  int count = (argc > 1) ? atoi(argv[1]) : 100000;
+
+  QVector<PaperMeta> records = SyntheticRecords(count);
+  for(int r = 0; r < records.size(); r++) records[r].recordId = r+1;
+
+  QElapsedTimer index_timer;
+  index_timer.start();
+  TextIndex title_words, review_words;
+  for(int r = 0; r < records.size(); r++)
+  {
+    title_words.Add(records[r].recordId, records[r].title);
+    review_words.Add(records[r].recordId, records[r].review);
+  }
+  std::cout << count << " synthetic records, word indexes built in " << index_timer.elapsed() << " ms\n";
+
+  // A common word, a rare word and an author's surname from the records
+  QStringList vocabulary = SyntheticVocabulary();
+  QString common = vocabulary[3];
+  QString rare = vocabulary[2500];
+  QString author = records[0].authors.section(", ", 0, 0).section(' ', 1);
+  QString keywords = QString("%1 %2").arg(common, rare);
+
+  std::cout << "Keywords \"" << keywords.toStdString() << "\", author " << author.toStdString() << ", 1990 to 2010\n";
+
+  runSearch("Per-record expressions", [&]()
+  {
+    return(searchPerRecord(records, keywords, author, 1990, 2010));
+  });
+
+  runSearch("Compiled plan", [&]()
+  {
+    return(searchWith(records, nullptr, nullptr, [&](Searcher &s)
+    {
+      s.SetKeywords(keywords, true, true);
+      s.SetAuthors(author);
+      s.SetYears(1990, 2010);
+    }));
+  });
+
+  runSearch("Compiled plan, word indexes", [&]()
+  {
+    return(searchWith(records, &title_words, &review_words, [&](Searcher &s)
+    {
+      s.SetKeywords(keywords, true, true);
+      s.SetAuthors(author);
+      s.SetYears(1990, 2010);
+    }));
+  });
+
+  runSearch("Rare word, word indexes", [&]()
+  {
+    return(searchWith(records, &title_words, &review_words, [&](Searcher &s) { s.SetKeywords(rare, true, true); }));
+  });
+
+  return(0);
+}
@@ -0,0 +1,51 @@
+#-------------------------------------------------
+#
+# Time of searches over a synthetic database
+#
+# qmake searchbench.pro && make && ./searchbench [records]
+#
+#-------------------------------------------------
+
+CONFIG   += c++11 console
+CONFIG   -= app_bundle
+QT       += core gui widgets xml concurrent sql
+
+# Compressed databases use the system's zlib where Qt does, otherwise the zlib built into
+# Qt; its headers come with the private modules, e.g. the qtbase-private-dev package
+qtConfig(system-zlib) {
+    LIBS += -lz
+} else {
+    QT   += core-private zlib-private
+}
+
+TARGET = searchbench
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+SOURCES += searchbench.cpp \
+    syntheticdatabase.cpp \
+    ../busyindicator.cpp \
+    ../databasecache.cpp \
+    ../databasefilereader.cpp \
+    ../databasefilewriter.cpp \
+    ../databasehandler.cpp \
+    ../databasejournal.cpp \
+    ../gzipdevice.cpp \
+    ../memoryreport.cpp \
+    ../performancelog.cpp \
+    ../reviewparser.cpp \
+    ../searchdialog.cpp \
+    ../searchquery.cpp \
+    ../sqlitestorage.cpp \
+    ../stringarena.cpp \
+    ../stringpool.cpp \
+    ../tagdictionary.cpp \
+    ../textindex.cpp \
+    ../xmlstorage.cpp
+
+HEADERS += syntheticdatabase.h \
+    ../busyindicator.h \
+    ../searchdialog.h
+
+FORMS   += ../searchdialog.ui
@@ -0,0 +1,119 @@
+/**
+ * @file   syntheticdatabase.cpp
+ * @brief  Synthetic databases for the benchmarks
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <QRandomGenerator>
+
+#include "syntheticdatabase.h"
+
+static const char *syllables[] =
+{
+  "ka", "lo", "mi", "ne", "ru", "sa", "ti", "vo", "ze", "pa", "qu", "ri", "de", "fo", "gu", "ha",
+  "ji", "ly", "mo", "nu", "tra", "stro", "phe", "gen", "tion", "al", "ic", "ous", "er", "ing"
+};
+
+static const int syllableCount = sizeof(syllables)/sizeof(syllables[0]);
+
+// Word made from the syllables of n
+static QString makeWord(int n)
+{
+  QString word;
+  do
+  {
+    word.append(syllables[n%syllableCount]);
+    n /= syllableCount;
+  } while(n > 0);
+
+  return(word);
+}
+
+// Words of the vocabulary, most frequent first
+QStringList SyntheticVocabulary()
+{
+  QStringList words;
+  for(int w = 0; w < SYNTHETIC_VOCABULARY_SIZE; w++) words << makeWord(w+syllableCount);
+
+  return(words);
+}
+
+// Word drawn with a roughly Zipfian frequency, so a few words are common and most are rare
+static const QString &drawWord(const QStringList &vocabulary, QRandomGenerator &random)
+{
+  double u = random.generateDouble();
+  int w = int(std::pow(double(vocabulary.size()), u))-1;
+
+  return(vocabulary[qBound(0, w, int(vocabulary.size()-1))]);
+}
+
+// Sentence of n words
+static QString makeText(const QStringList &vocabulary, QRandomGenerator &random, int n)
+{
+  QString text;
+  for(int w = 0; w < n; w++)
+  {
+    if(w > 0) text.append((w%12 == 0) ? QLatin1String(". ") : QLatin1String(" "));
+    text.append(drawWord(vocabulary, random));
+  }
+
+  return(text);
+}
+
+// Records with plausible fields
+QVector<PaperMeta> SyntheticRecords(int count, quint32 seed)
+{
+  QRandomGenerator random(seed);
+  QStringList vocabulary = SyntheticVocabulary();
+
+  QStringList surnames, publications, tags;
+  for(int s = 0; s < 500; s++) surnames << makeWord(s+1000).left(1).toUpper()+makeWord(s+1000).mid(1);
+  for(int p = 0; p < 200; p++) publications << QString("Journal of %1").arg(makeText(vocabulary, random, 2));
+  for(int t = 0; t < 50; t++) tags << makeWord(t+200);
+
+  static const VenueType venues[] = { VenueType::Journal, VenueType::Conference, VenueType::Symposium,
+                                      VenueType::Book, VenueType::Preprint, VenueType::Report };
+
+  QVector<PaperMeta> records;
+  records.reserve(count);
+
+  for(int r = 0; r < count; r++)
+  {
+    PaperMeta meta;
+
+    QStringList authors;
+    int author_count = 1+random.bounded(4);
+    for(int a = 0; a < author_count; a++)
+      authors << QString("%1. %2").arg(QChar('A'+random.bounded(26))).arg(surnames[random.bounded(surnames.size())]);
+
+    int year = 1970+random.bounded(56);
+
+    meta.authors     = authors.join(", ");
+    meta.year        = QString::number(year);
+    meta.citation    = QString("%1%2_%3").arg(surnames[random.bounded(surnames.size())]).arg(year).arg(r);
+    meta.title       = makeText(vocabulary, random, 6+random.bounded(8));
+    meta.review      = makeText(vocabulary, random, SYNTHETIC_REVIEW_WORDS);
+    meta.venue       = venues[random.bounded(int(sizeof(venues)/sizeof(venues[0])))];
+    meta.publication = publications[random.bounded(publications.size())];
+    meta.volume      = QString::number(1+random.bounded(60));
+    meta.issue       = QString::number(1+random.bounded(12));
+    meta.month       = QString::number(1+random.bounded(12));
+    meta.pageStart   = QString::number(1+random.bounded(900));
+    meta.pageEnd     = QString::number(meta.pageStart.toInt()+random.bounded(30));
+    meta.doi         = QString("10.%1/%2").arg(1000+random.bounded(9000)).arg(r);
+    meta.tags        = QString("%1, %2").arg(tags[random.bounded(tags.size())], tags[random.bounded(tags.size())]);
+    meta.reviewDate  = QDate(2000, 1, 1).addDays(random.bounded(9000));
+    meta.reader.rating        = 1+random.bounded(10);
+    meta.reader.understanding = 1+random.bounded(10);
+
+    records.push_back(meta);
+  }
+
+  std::sort(records.begin(), records.end());
+
+  return(records);
+}
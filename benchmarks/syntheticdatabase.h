@@ -0,0 +1,34 @@
+/**
+ * @file   syntheticdatabase.h
+ * @brief  Synthetic databases for the benchmarks
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#ifndef SYNTHETICDATABASE_H
+#define SYNTHETICDATABASE_H
+
+#include <QVector>
+#include <QStringList>
+
+#include "papermeta.h"
+
+/// Words reviews and titles are made from
+#define SYNTHETIC_VOCABULARY_SIZE 4000
+
+/// Words in each review
+#define SYNTHETIC_REVIEW_WORDS 150
+
+/**
+ * Records with plausible fields: titles and reviews are drawn from a fixed vocabulary with
+ * a skewed frequency, as real text is, and authors, publications and tags repeat across
+ * records. The same seed always gives the same records, sorted by citation key.
+ * @param count  number of records
+ * @param seed   seed of the random generator
+ */
+QVector<PaperMeta> SyntheticRecords(int count, quint32 seed = 1);
+
+/// Words of the vocabulary, most frequent first
+QStringList SyntheticVocabulary();
+
+#endif  // SYNTHETICDATABASE_H
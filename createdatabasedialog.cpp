@@ -82,12 +82,12 @@ void CreateDatabaseDialog::chooseDatabaseFile()
     // create
     filename = QFileDialog::getSaveFileName(this, tr("Database filename"),
                                             QString("%1/papers.rodb").arg(documents_path),
-                                            tr("Database files (*.rodb *.xml)"));
+                                            tr("Database files (*.rodb *.rodb.gz *.rosqlite *.xml)"));
     break;
 
     case 1:
     // load existing
-    filename = QFileDialog::getOpenFileName(this, tr("Database filename"), documents_path, tr("Database files (*.rodb *.xml)"));
+    filename = QFileDialog::getOpenFileName(this, tr("Database filename"), documents_path, tr("Database files (*.rodb *.rodb.gz *.rosqlite *.xml)"));
     break;
   }
 
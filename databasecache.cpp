@@ -0,0 +1,281 @@
+/**
+ * @file   databasecache.cpp
+ * @brief  Binary snapshot of a database for fast startup
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QHash>
+#include <QSysInfo>
+#include <QDebug>
+
+#include "databasecache.h"
+#include "stringarena.h"
+
+/// Magic number at the start of a cache file, "ROCA"
+#define DATABASE_CACHE_MAGIC 0x524f4341
+
+/// String fields of PaperMeta, in column order
+static QString PaperMeta::* const stringColumns[] =
+{
+  &PaperMeta::citation,    &PaperMeta::review,    &PaperMeta::paperPath,   &PaperMeta::authors,
+  &PaperMeta::title,       &PaperMeta::publication, &PaperMeta::volume,    &PaperMeta::issue,
+  &PaperMeta::month,       &PaperMeta::year,      &PaperMeta::dates,       &PaperMeta::pageStart,
+  &PaperMeta::pageEnd,     &PaperMeta::URL,       &PaperMeta::institution, &PaperMeta::location,
+  &PaperMeta::publisher,   &PaperMeta::ISBN,      &PaperMeta::doi,         &PaperMeta::note,
+  &PaperMeta::tags
+};
+
+/// String fields of ReviewerMeta, in column order after those of PaperMeta
+static QString ReviewerMeta::* const reviewerStringColumns[] =
+{
+  &ReviewerMeta::commentsToAuthors, &ReviewerMeta::commentsToChairEditor
+};
+
+/// Flags packed into one integer per record
+enum CacheFlags
+{
+  CacheReviewed    = 1,
+  CacheFinished    = 2,
+  CacheCorrections = 4
+};
+
+// Write a string column: offsets into a single block of UTF-16 data
+template<class Field>
+static void writeStringColumn(QDataStream &out, const QVector<PaperMeta> &records, Field field)
+{
+  QVector<quint32> offsets;
+  offsets.reserve(records.size()+1);
+
+  qsizetype length = 0;
+  for(int r = 0; r < records.size(); r++) length += field(records[r]).size();
+
+  QByteArray data;
+  data.reserve(length*sizeof(QChar));
+
+  offsets.push_back(0);
+  for(int r = 0; r < records.size(); r++)
+  {
+    const QString &text = field(records[r]);
+    data.append(reinterpret_cast<const char *>(text.constData()), text.size()*sizeof(QChar));
+    offsets.push_back(data.size()/sizeof(QChar));
+  }
+
+  out << offsets << data;
+}
+
+// Read a string column into the records from first onwards, placing the strings in arena
+template<class Field>
+static bool readStringColumn(QDataStream &in, QVector<PaperMeta> *records, int first, StringArena &arena, Field field)
+{
+  QVector<quint32> offsets;
+  QByteArray data;
+  in >> offsets >> data;
+
+  int count = records->size()-first;
+  if((in.status() != QDataStream::Ok) || (offsets.size() != count+1)) return(false);
+
+  const QChar *chars = reinterpret_cast<const QChar *>(data.constData());
+  quint32 limit = data.size()/sizeof(QChar);
+
+  for(int r = 0; r < count; r++)
+  {
+    quint32 begin = offsets[r];
+    quint32 end   = offsets[r+1];
+    if((end < begin) || (end > limit)) return(false);
+
+    if(end > begin)
+      field((*records)[first+r]) = arena.Copy(QStringView(chars+begin, end-begin));
+    else
+      field((*records)[first+r]).clear();
+  }
+
+  return(true);
+}
+
+// Write an integer column
+template<class Field>
+static void writeIntColumn(QDataStream &out, const QVector<PaperMeta> &records, Field field)
+{
+  QVector<qint32> values;
+  values.reserve(records.size());
+  for(int r = 0; r < records.size(); r++) values.push_back(field(records[r]));
+
+  out << values;
+}
+
+// Read an integer column into the records from first onwards
+template<class Setter>
+static bool readIntColumn(QDataStream &in, QVector<PaperMeta> *records, int first, Setter set)
+{
+  QVector<qint32> values;
+  in >> values;
+
+  int count = records->size()-first;
+  if((in.status() != QDataStream::Ok) || (values.size() != count)) return(false);
+
+  for(int r = 0; r < count; r++) set((*records)[first+r], values[r]);
+
+  return(true);
+}
+
+// Hash of the start and end of the database file
+quint64 DatabaseCache::Hash(const char *data, qint64 size)
+{
+  // Fixed seed so the hash is stable between runs
+  if(size <= 2*DATABASE_CACHE_HASH_SPAN)
+    return(qHashBits(data, size_t(size), size_t(DATABASE_CACHE_MAGIC)));
+
+  // Only the pages hashed are read from a mapped file
+  size_t head = qHashBits(data, DATABASE_CACHE_HASH_SPAN, size_t(DATABASE_CACHE_MAGIC));
+  return(qHashBits(data+size-DATABASE_CACHE_HASH_SPAN, DATABASE_CACHE_HASH_SPAN, head));
+}
+
+// Cache filename for a database file
+QString DatabaseCache::CacheFilename(const QString &database_filename)
+{
+  return(database_filename + DATABASE_CACHE_EXTENSION);
+}
+
+// Write the cache
+bool DatabaseCache::Write(const QString &filename, const DatabaseFileStamp &stamp,
+                          const QString &name, const QVector<PaperMeta> &records)
+{
+  QSaveFile output(filename);
+  if(!output.open(QIODevice::WriteOnly))
+    return(false);
+
+  QDataStream out(&output);
+  out.setVersion(QDataStream::Qt_6_0);
+
+  // The string blocks are stored in native byte order
+  out << quint32(DATABASE_CACHE_MAGIC) << quint32(DATABASE_CACHE_VERSION)
+      << quint8(QSysInfo::ByteOrder == QSysInfo::LittleEndian);
+  out << stamp.size << stamp.modified << stamp.hash;
+  out << name << qint32(records.size());
+
+  for(auto column : stringColumns)
+    writeStringColumn(out, records, [column](const PaperMeta &m) -> const QString & { return(m.*column); });
+
+  for(auto column : reviewerStringColumns)
+    writeStringColumn(out, records, [column](const PaperMeta &m) -> const QString & { return(m.reviewer.*column); });
+
+  writeIntColumn(out, records, [](const PaperMeta &m) { return(int(m.venue)); });
+  writeIntColumn(out, records, [](const PaperMeta &m) { return(int(m.thesis)); });
+  writeIntColumn(out, records, [](const PaperMeta &m) { return(m.reader.understanding); });
+  writeIntColumn(out, records, [](const PaperMeta &m) { return(m.reader.rating); });
+  writeIntColumn(out, records, [](const PaperMeta &m) { return(int(m.reviewer.accept)); });
+  writeIntColumn(out, records, [](const PaperMeta &m) { return(m.reviewer.suitability); });
+  writeIntColumn(out, records, [](const PaperMeta &m) { return(m.reviewer.technicalCorrectness); });
+  writeIntColumn(out, records, [](const PaperMeta &m) { return(m.reviewer.novelty); });
+  writeIntColumn(out, records, [](const PaperMeta &m) { return(m.reviewer.clarity); });
+  writeIntColumn(out, records, [](const PaperMeta &m) { return(m.reviewer.relevance); });
+  writeIntColumn(out, records, [](const PaperMeta &m)
+  {
+    int flags = 0;
+    if(m.reviewed)                     flags |= CacheReviewed;
+    if(m.reader.finished)              flags |= CacheFinished;
+    if(m.reviewer.correctionsRequired) flags |= CacheCorrections;
+    return(flags);
+  });
+
+  QVector<qint64> dates;
+  dates.reserve(records.size());
+  for(int r = 0; r < records.size(); r++) dates.push_back(records[r].reviewDate.toJulianDay());
+  out << dates;
+
+  if(out.status() != QDataStream::Ok)
+  {
+    output.cancelWriting();
+    return(false);
+  }
+
+  return(output.commit());
+}
+
+// Read the cache if it matches the database file
+bool DatabaseCache::Read(const QString &filename, const DatabaseFileStamp &stamp,
+                         QString &name, QVector<PaperMeta> *records)
+{
+  QFile input(filename);
+  if(!input.open(QIODevice::ReadOnly))
+    return(false);
+
+  QDataStream in(&input);
+  in.setVersion(QDataStream::Qt_6_0);
+
+  quint32 magic, version;
+  quint8 little_endian;
+  DatabaseFileStamp cached;
+  in >> magic >> version >> little_endian;
+  in >> cached.size >> cached.modified >> cached.hash;
+
+  if((in.status() != QDataStream::Ok) || (magic != DATABASE_CACHE_MAGIC) || (version != DATABASE_CACHE_VERSION))
+    return(false);
+
+  if(bool(little_endian) != (QSysInfo::ByteOrder == QSysInfo::LittleEndian))
+    return(false);
+
+  if(!(cached == stamp))
+    return(false);
+
+  QString cached_name;
+  qint32 count;
+  in >> cached_name >> count;
+  if((in.status() != QDataStream::Ok) || (count < 0)) return(false);
+
+  int first = records->size();
+  records->resize(first+count);
+
+  bool result = true;
+  StringArena arena;
+
+  for(auto column : stringColumns)
+    result = result && readStringColumn(in, records, first, arena, [column](PaperMeta &m) -> QString & { return(m.*column); });
+
+  for(auto column : reviewerStringColumns)
+    result = result && readStringColumn(in, records, first, arena, [column](PaperMeta &m) -> QString & { return(m.reviewer.*column); });
+
+  result = result && readIntColumn(in, records, first, [](PaperMeta &m, int v) { m.venue = VenueType(v); });
+  result = result && readIntColumn(in, records, first, [](PaperMeta &m, int v) { m.thesis = ThesisType(v); });
+  result = result && readIntColumn(in, records, first, [](PaperMeta &m, int v) { m.reader.understanding = v; });
+  result = result && readIntColumn(in, records, first, [](PaperMeta &m, int v) { m.reader.rating = v; });
+  result = result && readIntColumn(in, records, first, [](PaperMeta &m, int v) { m.reviewer.accept = Acceptance(v); });
+  result = result && readIntColumn(in, records, first, [](PaperMeta &m, int v) { m.reviewer.suitability = v; });
+  result = result && readIntColumn(in, records, first, [](PaperMeta &m, int v) { m.reviewer.technicalCorrectness = v; });
+  result = result && readIntColumn(in, records, first, [](PaperMeta &m, int v) { m.reviewer.novelty = v; });
+  result = result && readIntColumn(in, records, first, [](PaperMeta &m, int v) { m.reviewer.clarity = v; });
+  result = result && readIntColumn(in, records, first, [](PaperMeta &m, int v) { m.reviewer.relevance = v; });
+  result = result && readIntColumn(in, records, first, [](PaperMeta &m, int v)
+  {
+    m.reviewed                     = (v & CacheReviewed);
+    m.reader.finished              = (v & CacheFinished);
+    m.reviewer.correctionsRequired = (v & CacheCorrections);
+  });
+
+  if(result)
+  {
+    QVector<qint64> dates;
+    in >> dates;
+
+    if((in.status() == QDataStream::Ok) && (dates.size() == count))
+    {
+      for(int r = 0; r < count; r++) (*records)[first+r].reviewDate = QDate::fromJulianDay(dates[r]);
+    }
+    else
+      result = false;
+  }
+
+  if(!result)
+  {
+    qDebug() << "Cache: " << filename << " is damaged\n";
+    records->resize(first);
+    return(false);
+  }
+
+  name = cached_name;
+  return(true);
+}
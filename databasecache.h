@@ -0,0 +1,81 @@
+/**
+ * @file   databasecache.h
+ * @brief  Binary snapshot of a database for fast startup
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#ifndef DATABASECACHE_H
+#define DATABASECACHE_H
+
+#include <QString>
+#include <QVector>
+
+#include "papermeta.h"
+
+/// Extension appended to the database filename for its cache
+#define DATABASE_CACHE_EXTENSION ".rocache"
+
+/// Version of the cache format; caches of other versions are ignored
+#define DATABASE_CACHE_VERSION 2
+
+/// Bytes hashed at each end of the database file to check the cache is for it
+#define DATABASE_CACHE_HASH_SPAN 4096
+
+/// Identifies the state of a database file the cache was made from
+struct DatabaseFileStamp
+{
+  qint64  size;                        ///< File size in bytes
+  qint64  modified;                    ///< Modification time, ms since epoch
+  quint64 hash;                        ///< Hash of the start and end of the file
+
+  bool operator==(const DatabaseFileStamp &rhs) const
+  {
+    return((size == rhs.size) && (modified == rhs.modified) && (hash == rhs.hash));
+  }
+};
+
+/**
+ * @brief Read and write the binary cache kept next to a database file
+ *
+ * The cache is a columnar snapshot of the records: each string field is stored as one
+ * block of UTF-16 data with an offset table, and each scalar field as an array. The XML
+ * database is always the source of truth; a cache is only used when its stamp matches
+ * the current database file.
+ */
+class DatabaseCache
+{
+public:
+  /**
+   * Hash of the first and last DATABASE_CACHE_HASH_SPAN bytes of the database file. With
+   * the size and modification time this finds a file that was replaced or edited, without
+   * reading all of it at every start.
+   */
+  static quint64 Hash(const char *data, qint64 size);
+
+  /// Cache filename for a database file
+  static QString CacheFilename(const QString &database_filename);
+
+  /**
+   * Write the cache
+   * @param filename  cache filename
+   * @param stamp     stamp of the database file the records were read from/saved to
+   * @param name      name of the database
+   * @param records   the records
+   */
+  static bool Write(const QString &filename, const DatabaseFileStamp &stamp,
+                    const QString &name, const QVector<PaperMeta> &records);
+
+  /**
+   * Read the cache if it matches the database file
+   * @param filename  cache filename
+   * @param stamp     stamp of the current database file
+   * @param name      name of the database
+   * @param records   records are appended here
+   * @return false if the cache is missing, stale or damaged
+   */
+  static bool Read(const QString &filename, const DatabaseFileStamp &stamp,
+                   QString &name, QVector<PaperMeta> *records);
+};
+
+#endif  // DATABASECACHE_H
@@ -10,28 +10,280 @@
 #endif
 
 #include "databasefilereader.h"
+#include "databasefilewriter.h"
+#include "gzipdevice.h"
+
+#include <cstring>
+#include <algorithm>
 
 #include <QDebug>
+#include <QtConcurrent>
+
+/// Name of an element or attribute of a record
+struct RecordFieldName
+{
+  QLatin1String                  name;
+  DatabaseFileReader::RecordField field;
+};
+
+static const RecordFieldName recordFieldNames[] =
+{
+  { QLatin1String("review"),         DatabaseFileReader::RecordField::Review },
+  { QLatin1String("paperPath"),      DatabaseFileReader::RecordField::PaperPath },
+  { QLatin1String("venue"),          DatabaseFileReader::RecordField::Venue },
+  { QLatin1String("authors"),        DatabaseFileReader::RecordField::Authors },
+  { QLatin1String("title"),          DatabaseFileReader::RecordField::Title },
+  { QLatin1String("publication"),    DatabaseFileReader::RecordField::Publication },
+  { QLatin1String("volume"),         DatabaseFileReader::RecordField::Volume },
+  { QLatin1String("issue"),          DatabaseFileReader::RecordField::Issue },
+  { QLatin1String("month"),          DatabaseFileReader::RecordField::Month },
+  { QLatin1String("year"),           DatabaseFileReader::RecordField::Year },
+  { QLatin1String("dates"),          DatabaseFileReader::RecordField::Dates },
+  { QLatin1String("pageStart"),      DatabaseFileReader::RecordField::PageStart },
+  { QLatin1String("pageEnd"),        DatabaseFileReader::RecordField::PageEnd },
+  { QLatin1String("url"),            DatabaseFileReader::RecordField::URL },
+  { QLatin1String("thesis"),         DatabaseFileReader::RecordField::Thesis },
+  { QLatin1String("institution"),    DatabaseFileReader::RecordField::Institution },
+  { QLatin1String("location"),       DatabaseFileReader::RecordField::Location },
+  { QLatin1String("publisher"),      DatabaseFileReader::RecordField::Publisher },
+  { QLatin1String("ISBN"),           DatabaseFileReader::RecordField::ISBN },
+  { QLatin1String("DOI"),            DatabaseFileReader::RecordField::DOI },
+  { QLatin1String("note"),           DatabaseFileReader::RecordField::Note },
+  { QLatin1String("reviewDate"),     DatabaseFileReader::RecordField::ReviewDate },
+  { QLatin1String("tags"),           DatabaseFileReader::RecordField::Tags },
+  { QLatin1String("reviewed"),       DatabaseFileReader::RecordField::Reviewed },
+  { QLatin1String("reader"),         DatabaseFileReader::RecordField::Reader },
+  { QLatin1String("reviewer"),       DatabaseFileReader::RecordField::Reviewer },
+  { QLatin1String("finished"),       DatabaseFileReader::RecordField::Finished },
+  { QLatin1String("understanding"),  DatabaseFileReader::RecordField::Understanding },
+  { QLatin1String("rating"),         DatabaseFileReader::RecordField::Rating },
+  { QLatin1String("accept"),         DatabaseFileReader::RecordField::Accept },
+  { QLatin1String("suitability"),    DatabaseFileReader::RecordField::Suitability },
+  { QLatin1String("correctness"),    DatabaseFileReader::RecordField::Correctness },
+  { QLatin1String("novelty"),        DatabaseFileReader::RecordField::Novelty },
+  { QLatin1String("clarity"),        DatabaseFileReader::RecordField::Clarity },
+  { QLatin1String("relevance"),      DatabaseFileReader::RecordField::Relevance },
+  { QLatin1String("corrections"),    DatabaseFileReader::RecordField::Corrections },
+  { QLatin1String("authorComments"), DatabaseFileReader::RecordField::AuthorComments },
+  { QLatin1String("editorComments"), DatabaseFileReader::RecordField::EditorComments }
+};
+
+/// Slots in the field name hash table, a power of two well above the number of names
+#define RECORD_FIELD_SLOTS 128
+
+// Hash of an element or attribute name; works on Latin-1 and UTF-16 views alike
+template<class Name>
+static inline uint recordFieldHash(const Name &name)
+{
+  uint hash = 2166136261u;
+  for(qsizetype c = 0; c < name.size(); c++)
+  {
+    hash ^= name[c].unicode();
+    hash *= 16777619u;
+  }
+
+  return(hash);
+}
+
+/// Open addressed hash table from field name to its entry in recordFieldNames
+struct RecordFieldTable
+{
+  quint8 slots[RECORD_FIELD_SLOTS];    ///< Index into recordFieldNames plus one, zero if empty
+
+  RecordFieldTable()
+  {
+    memset(slots, 0, sizeof(slots));
+
+    for(size_t n = 0; n < sizeof(recordFieldNames)/sizeof(recordFieldNames[0]); n++)
+    {
+      uint slot = recordFieldHash(recordFieldNames[n].name) & (RECORD_FIELD_SLOTS-1);
+      while(slots[slot]) slot = (slot+1) & (RECORD_FIELD_SLOTS-1);
+      slots[slot] = quint8(n+1);
+    }
+  }
+};
+
+// Field for an element or attribute name; no strings are created
+template<class Name>
+static DatabaseFileReader::RecordField recordField(const Name &name)
+{
+  static const RecordFieldTable table;
+
+  uint slot = recordFieldHash(name) & (RECORD_FIELD_SLOTS-1);
+  while(table.slots[slot])
+  {
+    const RecordFieldName &entry = recordFieldNames[table.slots[slot]-1];
+    if(name == entry.name) return(entry.field);
+
+    slot = (slot+1) & (RECORD_FIELD_SLOTS-1);
+  }
+
+  return(DatabaseFileReader::RecordField::Unknown);
+}
+
+// Venue type from its name in the database file
+static VenueType venueFromText(QStringView vts)
+{
+  if(vts == QLatin1String("Journal"))            return(VenueType::Journal);
+  else if(vts == QLatin1String("Conference"))    return(VenueType::Conference);
+  else if(vts == QLatin1String("Symposium"))     return(VenueType::Symposium);
+  else if(vts == QLatin1String("Book"))          return(VenueType::Book);
+  else if(vts == QLatin1String("Preprint"))      return(VenueType::Preprint);
+  else if(vts == QLatin1String("Thesis"))        return(VenueType::Thesis);
+  else if(vts == QLatin1String("Report"))        return(VenueType::Report);
+  else if(vts == QLatin1String("SelfPublished")) return(VenueType::SelfPublished);
+  else if(vts == QLatin1String("NotPublished"))  return(VenueType::NotPublished);
+  else if(vts == QLatin1String("None"))          return(VenueType::NoVenue);
+
+  return(VenueType::UnknownVenue);
+}
+
+// Thesis type from its name in the database file
+static ThesisType thesisFromText(QStringView tts)
+{
+  if(tts == QLatin1String("Doctorate"))      return(ThesisType::Doctorate);
+  else if(tts == QLatin1String("Masters"))   return(ThesisType::Masters);
+  else if(tts == QLatin1String("Bachelors")) return(ThesisType::Bachelors);
+  else if(tts == QLatin1String("College"))   return(ThesisType::College);
+
+  return(ThesisType::UnknownThesisType);
+}
+
+// Acceptance from its name in the database file
+static Acceptance acceptFromText(QStringView accept_type)
+{
+  if(accept_type == QLatin1String("AcceptStrong"))      return(Accept_Strong);
+  else if(accept_type == QLatin1String("AcceptWeak"))   return(Accept_Weak);
+  else if(accept_type == QLatin1String("RejectWeak"))   return(Reject_Weak);
+  else if(accept_type == QLatin1String("RejectStrong")) return(Reject_Strong);
+
+  return(Accept_Neutral);
+}
+
+// Venue type from its code in a version 2 file
+static VenueType venueFromCode(int code)
+{
+  if((code < 0) || (code > static_cast<int>(VenueType::UnknownVenue))) return(VenueType::UnknownVenue);
+
+  return(static_cast<VenueType>(code));
+}
+
+// Thesis type from its code in a version 2 file
+static ThesisType thesisFromCode(int code)
+{
+  if((code < 0) || (code > static_cast<int>(ThesisType::UnknownThesisType))) return(ThesisType::UnknownThesisType);
+
+  return(static_cast<ThesisType>(code));
+}
+
+// Acceptance from its code in a version 2 file
+static Acceptance acceptFromCode(int code)
+{
+  if((code < Accept_Strong) || (code > Reject_Strong)) return(Accept_Neutral);
+
+  return(static_cast<Acceptance>(code));
+}
+
+// Find a string in the mapped memory, returns end if not found
+static const char *findInMapping(const char *from, const char *end, const char *text)
+{
+  return(std::search(from, end, text, text+strlen(text)));
+}
+
+// Mapped memory at pos starts with text
+static bool mappingStartsWith(const char *pos, const char *end, const char *text)
+{
+  size_t length = strlen(text);
+  return((size_t(end-pos) >= length) && (memcmp(pos, text, length) == 0));
+}
+
+// Character is XML whitespace
+static inline bool isSpace(char c)
+{
+  return((c == ' ') || (c == '\n') || (c == '\t') || (c == '\r'));
+}
+
+// Integer from undecoded text in the mapping; numbers are written without entities
+static int mappedNumber(QLatin1String raw)
+{
+  const char *p = raw.data();
+  const char *end = p+raw.size();
+
+  while((p < end) && isSpace(*p)) p++;
+
+  bool negative = (p < end) && (*p == '-');
+  if(negative) p++;
+
+  int value = 0;
+  while((p < end) && (*p >= '0') && (*p <= '9'))
+  {
+    value = value*10 + (*p-'0');
+    p++;
+  }
+
+  return(negative ? -value : value);
+}
 
 DatabaseFileReader::DatabaseFileReader() : databaseStarted(false),databaseFileVersion(-1)
 {
   targetDatabase = nullptr;
+  gzip = nullptr;
+  mapBase = nullptr;
+  mapPos = nullptr;
+  mapEnd = nullptr;
+  lazyReviews = false;
 }
 
 // Destructor
-DatabaseFileReader::~DatabaseFileReader() { };
+DatabaseFileReader::~DatabaseFileReader()
+{
+  delete gzip;
+}
 
 // Read the database
 bool DatabaseFileReader::Read(QIODevice *device, QString &db_name, QVector<PaperMeta> *database)
 {
-  targetDatabase = database;
+  if(Open(device, db_name))
+  {
+    PaperMeta meta;
+    while(ReadNext(meta)) database->push_back(meta);
+  }
+
+#ifdef DEBUG_XMLREADER
+  switch(reader.error())
+  {
+    case QXmlStreamReader::NoError:                     std::cerr << "Read() no error\n"; break;
+    case QXmlStreamReader::NotWellFormedError:          std::cerr << "Read() not well formed\n"; break;
+    case QXmlStreamReader::PrematureEndOfDocumentError: std::cerr << "Read() early end of document\n"; break;
+    case QXmlStreamReader::UnexpectedElementError:      std::cerr << "Read() unexpected element\n"; break;
+    case QXmlStreamReader::CustomError:                 std::cerr << "Read() custom error\n"; break;
+  }
+#endif
+
+  return(!HasError());
+}
+
+// Start reading the records of a database one at a time
+bool DatabaseFileReader::Open(QIODevice *device, QString &db_name)
+{
+  databaseStarted = false;
+
+  // Compressed files are decompressed as they are read
+  delete gzip;
+  gzip = nullptr;
+  if(GzipDevice::IsCompressed(device))
+  {
+    gzip = new GzipDevice(device);
+    if(!gzip->open(QIODevice::ReadOnly)) return(false);
+    device = gzip;
+  }
 
   reader.setDevice(device);
 
   while(!reader.atEnd())
   {
     reader.readNext();
-    if(reader.isStartElement() && (reader.name().toString() == "bibliography"))
+    if(reader.isStartElement() && (reader.name() == QLatin1String("bibliography")))
     {
       bool result = true;
 
@@ -39,6 +291,13 @@ bool DatabaseFileReader::Read(QIODevice *device, QString &db_name, QVector<Paper
       {
         databaseFileVersion = reader.attributes().value("version").toInt(&result);
         // if(!result) reader.raiseError(QObject::tr("Database file version not found"));
+
+        // A file written by a newer program would lose the fields this one does not know
+        if(result && (databaseFileVersion > QByteArray(DATABASE_VERSION).toInt()))
+        {
+          reader.raiseError(QObject::tr("Database file version %1 is newer than this program can read").arg(databaseFileVersion));
+          result = false;
+        }
       }
 
       if(reader.attributes().hasAttribute("name"))
@@ -46,51 +305,123 @@ bool DatabaseFileReader::Read(QIODevice *device, QString &db_name, QVector<Paper
         db_name = reader.attributes().value("name").toString();
       }
 
-      if(result) readRecordList();
+      databaseStarted = result;
+      break;
     }
   }
 
-#ifdef DEBUG_XMLREADER
-  switch(reader.error())
-  {
-    case QXmlStreamReader::NoError:                     std::cerr << "Read() no error\n"; break;
-    case QXmlStreamReader::NotWellFormedError:          std::cerr << "Read() not well formed\n"; break;
-    case QXmlStreamReader::PrematureEndOfDocumentError: std::cerr << "Read() early end of document\n"; break;
-    case QXmlStreamReader::UnexpectedElementError:      std::cerr << "Read() unexpected element\n"; break;
-    case QXmlStreamReader::CustomError:                 std::cerr << "Read() custom error\n"; break;
-  }
-#endif
-
-  return(reader.error() == QXmlStreamReader::NoError);
+  return(!HasError());
 }
 
-// Read the list of records
-void DatabaseFileReader::readRecordList()
+// Read the next record
+bool DatabaseFileReader::ReadNext(PaperMeta &meta)
 {
+  if(!databaseStarted) return(false);
+
   while(reader.readNextStartElement())
   {
-    if(reader.name().toString() == "record")
+    if(reader.name() == QLatin1String("record"))
     {
       record.Clear();
+      readRecordAttributes();
+      readPaperMeta();
 
-      if(reader.attributes().hasAttribute("citation"))
-        record.citation = reader.attributes().value("citation").toString();
+      if(reader.hasError()) break;
 
-      readRecordDetails();
+      meta = record;
+      return(true);
     }
     else
       reader.skipCurrentElement();
   }
+
+  // The rest of the document is read so that errors after the records are reported
+  databaseStarted = false;
+  while(!reader.atEnd()) reader.readNext();
+
+  return(false);
 }
 
-// Read the record extended metadata
-void DatabaseFileReader::readRecordDetails()
+// Reading stopped with an error
+bool DatabaseFileReader::HasError() const
 {
-  // Read the PaperMeta
-  readPaperMeta();
+  return((reader.error() != QXmlStreamReader::NoError) || (gzip && gzip->HasError()));
+}
 
-  // Store in the database
-  targetDatabase->push_back(record);
+// Read the citation and the fields stored as attributes of a version 2 record
+void DatabaseFileReader::readRecordAttributes()
+{
+  const QXmlStreamAttributes attributes = reader.attributes();
+
+  for(const QXmlStreamAttribute &attribute : attributes)
+  {
+    QStringView name = attribute.name();
+    if(name == QLatin1String("citation"))
+    {
+      record.citation = attribute.value().toString();
+      continue;
+    }
+
+    RecordField field = recordField(name);
+    if(QString *text = textField(field))
+      *text = attribute.value().toString();
+    else
+      setNumberField(field, attribute.value().toInt());
+  }
+}
+
+// String of the current record holding a text field, or nullptr
+QString *DatabaseFileReader::textField(RecordField field)
+{
+  switch(field)
+  {
+    case RecordField::Review:         return(&record.review);
+    case RecordField::PaperPath:      return(&record.paperPath);
+    case RecordField::Authors:        return(&record.authors);
+    case RecordField::Title:          return(&record.title);
+    case RecordField::Publication:    return(&record.publication);
+    case RecordField::Volume:         return(&record.volume);
+    case RecordField::Issue:          return(&record.issue);
+    case RecordField::Month:          return(&record.month);
+    case RecordField::Year:           return(&record.year);
+    case RecordField::Dates:          return(&record.dates);
+    case RecordField::PageStart:      return(&record.pageStart);
+    case RecordField::PageEnd:        return(&record.pageEnd);
+    case RecordField::URL:            return(&record.URL);
+    case RecordField::Institution:    return(&record.institution);
+    case RecordField::Location:       return(&record.location);
+    case RecordField::Publisher:      return(&record.publisher);
+    case RecordField::ISBN:           return(&record.ISBN);
+    case RecordField::DOI:            return(&record.doi);
+    case RecordField::Note:           return(&record.note);
+    case RecordField::Tags:           return(&record.tags);
+    case RecordField::AuthorComments: return(&record.reviewer.commentsToAuthors);
+    case RecordField::EditorComments: return(&record.reviewer.commentsToChairEditor);
+    default:                          return(nullptr);
+  }
+}
+
+// Set a field of the current record stored as a number in version 2 files
+void DatabaseFileReader::setNumberField(RecordField field, int value)
+{
+  switch(field)
+  {
+    case RecordField::Venue:         record.venue = venueFromCode(value);                    break;
+    case RecordField::Thesis:        record.thesis = thesisFromCode(value);                  break;
+    case RecordField::ReviewDate:    record.reviewDate = QDate::fromJulianDay(value);        break;
+    case RecordField::Reviewed:      record.reviewed = (value != 0);                         break;
+    case RecordField::Finished:      record.reader.finished = (value != 0);                  break;
+    case RecordField::Understanding: record.reader.understanding = value;                    break;
+    case RecordField::Rating:        record.reader.rating = value;                           break;
+    case RecordField::Accept:        record.reviewer.accept = acceptFromCode(value);         break;
+    case RecordField::Suitability:   record.reviewer.suitability = value;                    break;
+    case RecordField::Correctness:   record.reviewer.technicalCorrectness = value;           break;
+    case RecordField::Novelty:       record.reviewer.novelty = value;                        break;
+    case RecordField::Clarity:       record.reviewer.clarity = value;                        break;
+    case RecordField::Relevance:     record.reviewer.relevance = value;                      break;
+    case RecordField::Corrections:   record.reviewer.correctionsRequired = (value != 0);     break;
+    default:                                                                                 break;
+  }
 }
 
 // Read meta data describing the paper
@@ -101,97 +432,26 @@ void DatabaseFileReader::readPaperMeta()
     QXmlStreamReader::TokenType tt = reader.readNext();
     if(tt == QXmlStreamReader::StartElement)
     {
-      QString name = reader.name().toString();
-      if(name == "review")
-        record.review = reader.readElementText();
-      else if(name == "paperPath")
-        record.paperPath = reader.readElementText();
-      else if(name == "venue")
+      RecordField field = recordField(reader.name());
+      if(QString *text = textField(field))
       {
-        QString vts = reader.readElementText();
-        if(vts == "Journal")
-          record.venue = VenueType::Journal;
-        else if(vts == "Conference")
-          record.venue = VenueType::Conference;
-        else if(vts == "Symposium")
-          record.venue = VenueType::Symposium;
-        else if(vts == "Book")
-          record.venue = VenueType::Book;
-        else if(vts == "Preprint")
-          record.venue = VenueType::Preprint;
-        else if(vts == "Thesis")
-          record.venue = VenueType::Thesis;
-        else if(vts == "Report")
-          record.venue = VenueType::Report;
-        else if(vts == "SelfPublished")
-          record.venue = VenueType::SelfPublished;
-        else if(vts == "NotPublished")
-          record.venue = VenueType::NotPublished;
-        else if(vts == "None")
-          record.venue = VenueType::NoVenue;
-        else if(vts == "Unknown")
-          record.venue = VenueType::UnknownVenue;
+        *text = reader.readElementText();
+        continue;
       }
-      else if(name == "authors")
-        record.authors = reader.readElementText();
-      else if(name == "title")
-        record.title = reader.readElementText();
-      else if(name == "publication")
-        record.publication = reader.readElementText();
-      else if(name == "volume")
-        record.volume = reader.readElementText();
-      else if(name == "issue")
-        record.issue = reader.readElementText();
-      else if(name == "month")
-        record.month = reader.readElementText();
-      else if(name == "year")
-        record.year = reader.readElementText();
-      else if(name == "dates")
-        record.dates = reader.readElementText();
-      else if(name == "pageStart")
-        record.pageStart = reader.readElementText();
-      else if(name == "pageEnd")
-        record.pageEnd = reader.readElementText();
-      else if(name == "url")
-        record.URL = reader.readElementText();
-      else if(name == "thesis")
+
+      switch(field)
       {
-        QString tts = reader.readElementText();
-        if(tts == "Doctorate")
-          record.thesis = ThesisType::Doctorate;
-        if(tts == "Masters")
-          record.thesis = ThesisType::Masters;
-        if(tts == "Bachelors")
-          record.thesis = ThesisType::Bachelors;
-        if(tts == "College")
-          record.thesis = ThesisType::College;
-        if(tts == "Unknown")
-          record.thesis = ThesisType::UnknownThesisType;
+        case RecordField::Venue:      record.venue = venueFromText(reader.readElementText());         break;
+        case RecordField::Thesis:     record.thesis = thesisFromText(reader.readElementText());       break;
+        case RecordField::ReviewDate: record.reviewDate = QDate::fromString(reader.readElementText()); break;
+        case RecordField::Reviewed:   record.reviewed = true;                                          break;
+        case RecordField::Reader:     readReaderMeta();                                                break;
+        case RecordField::Reviewer:   readReviewerMeta();                                              break;
+        default:                                                                                       break;
       }
-      else if(name == "institution")
-        record.institution = reader.readElementText();
-      else if(name == "location")
-        record.location = reader.readElementText();
-      else if(name == "publisher")
-        record.publisher = reader.readElementText();
-      else if(name == "ISBN")
-        record.ISBN = reader.readElementText();
-      else if(name == "DOI")
-        record.doi = reader.readElementText();
-      else if(name == "note")
-        record.note = reader.readElementText();
-      else if(name == "reviewDate")
-        record.reviewDate = QDate::fromString(reader.readElementText());
-      else if(name == "tags")
-        record.tags = reader.readElementText();
-      else if(name == "reviewed")
-        record.reviewed = true;
-      else if(name == "reader")
-        readReaderMeta();
-      else if(name == "reviewer")
-        readReviewerMeta();
-    }
-    else if((tt == QXmlStreamReader::EndElement) && (reader.name().toString() == "record"))
+    }
+    else if((tt == QXmlStreamReader::Invalid) ||
+            ((tt == QXmlStreamReader::EndElement) && (reader.name() == QLatin1String("record"))))
       break;
   }
 }
@@ -204,15 +464,16 @@ void DatabaseFileReader::readReaderMeta()
     QXmlStreamReader::TokenType tt = reader.readNext();
     if(tt == QXmlStreamReader::StartElement)
     {
-      QString name = reader.name().toString();
-      if(name == "finished")
-        record.reader.finished = true;
-      else if(name == "understanding")
-        record.reader.understanding = reader.readElementText().toInt();
-      else if(name == "rating")
-        record.reader.rating = reader.readElementText().toInt();
+      switch(recordField(reader.name()))
+      {
+        case RecordField::Finished:      record.reader.finished = true;                             break;
+        case RecordField::Understanding: record.reader.understanding = reader.readElementText().toInt(); break;
+        case RecordField::Rating:        record.reader.rating = reader.readElementText().toInt();        break;
+        default:                                                                                    break;
+      }
     }
-    else if((tt == QXmlStreamReader::EndElement) && (reader.name().toString() == "reader"))
+    else if((tt == QXmlStreamReader::Invalid) ||
+            ((tt == QXmlStreamReader::EndElement) && (reader.name() == QLatin1String("reader"))))
       return;
   }
 }
@@ -225,34 +486,770 @@ void DatabaseFileReader::readReviewerMeta()
     QXmlStreamReader::TokenType tt = reader.readNext();
     if(tt == QXmlStreamReader::StartElement)
     {
-      QString name = reader.name().toString();
-      if(name == "accept")
+      RecordField field = recordField(reader.name());
+      switch(field)
       {
-        QString accept_type = reader.readElementText();
-        if(accept_type == "AcceptStrong") record.reviewer.accept = Accept_Strong;
-        else if(accept_type == "AcceptWeak") record.reviewer.accept = Accept_Weak;
-        else if(accept_type == "AcceptNeutral") record.reviewer.accept = Accept_Neutral;
-        else if(accept_type == "RejectWeak") record.reviewer.accept = Reject_Weak;
-        else if(accept_type == "RejectStrong") record.reviewer.accept = Reject_Strong;
-      }
-      else if(name == "suitability")
-        record.reviewer.suitability = reader.readElementText().toInt();
-      else if(name == "correctness")
-        record.reviewer.technicalCorrectness = reader.readElementText().toInt();
-      else if(name == "novelty")
-        record.reviewer.novelty = reader.readElementText().toInt();
-      else if(name == "clarity")
-        record.reviewer.clarity = reader.readElementText().toInt();
-      else if(name == "relevance")
-        record.reviewer.relevance = reader.readElementText().toInt();
-      else if(name == "corrections")
+        case RecordField::Accept:
+        record.reviewer.accept = acceptFromText(reader.readElementText());
+        break;
+
+        case RecordField::Corrections:
         record.reviewer.correctionsRequired = true;
-      else if(name == "authorComments")
-        record.reviewer.commentsToAuthors = reader.readElementText();
-      else if(name == "editorComments")
-        record.reviewer.commentsToChairEditor = reader.readElementText();
+        break;
+
+        case RecordField::AuthorComments:
+        case RecordField::EditorComments:
+        *textField(field) = reader.readElementText();
+        break;
+
+        case RecordField::Suitability:
+        case RecordField::Correctness:
+        case RecordField::Novelty:
+        case RecordField::Clarity:
+        case RecordField::Relevance:
+        setNumberField(field, reader.readElementText().toInt());
+        break;
+
+        default:
+        break;
+      }
     }
-    else if((tt == QXmlStreamReader::EndElement) && (reader.name().toString() == "reviewer"))
+    else if((tt == QXmlStreamReader::Invalid) ||
+            ((tt == QXmlStreamReader::EndElement) && (reader.name() == QLatin1String("reviewer"))))
       return;
   }
 }
+
+// Read the changes in a database journal
+bool DatabaseFileReader::ReadJournal(QIODevice *device, QVector<DatabaseChange> *changes)
+{
+  // The journal is a sequence of change elements without a document element
+  QByteArray data = device->readAll();
+  data.prepend("<journal>");
+  data.append("</journal>");
+
+  reader.clear();
+  reader.addData(data);
+
+  if(!reader.readNextStartElement() || (reader.name() != QLatin1String("journal")))
+    return(false);
+
+  while(reader.readNextStartElement())
+  {
+    if(reader.name() != QLatin1String("change"))
+    {
+      reader.skipCurrentElement();
+      continue;
+    }
+
+    DatabaseChange change;
+    QXmlStreamAttributes attributes = reader.attributes();
+    QString op = attributes.value("op").toString();
+
+    if(op == "edit")        change.type = ChangeType::Edit;
+    else if(op == "rename") change.type = ChangeType::Rename;
+    else if(op == "delete") change.type = ChangeType::Delete;
+    else if(op == "name")   change.type = ChangeType::Name;
+    else
+    {
+      reader.skipCurrentElement();
+      continue;
+    }
+
+    if(attributes.hasAttribute("version"))
+      databaseFileVersion = attributes.value("version").toInt();
+
+    change.key = attributes.value("citation").toString();
+    change.name = attributes.value("name").toString();
+
+    bool have_record = false;
+    while(reader.readNextStartElement())
+    {
+      if(reader.name() == QLatin1String("record"))
+      {
+        record.Clear();
+        readRecordAttributes();
+        readPaperMeta();
+
+        change.record = record;
+        have_record = true;
+      }
+      else
+        reader.skipCurrentElement();
+    }
+
+    // A change cut short by an interrupted write ends the journal
+    if(reader.hasError()) break;
+
+    if(have_record || (change.type == ChangeType::Delete) || (change.type == ChangeType::Name))
+      changes->push_back(change);
+  }
+
+  if(reader.hasError())
+    qDebug() << "Reader: journal ends with an incomplete change, line " << reader.lineNumber() << "\n";
+
+  return(true);
+}
+
+// Read the database directly from a memory mapped file
+bool DatabaseFileReader::ReadMapped(const char *data, qint64 size, QString &db_name, QVector<PaperMeta> *database)
+{
+  targetDatabase = database;
+
+  bool empty;
+  if(!mappedHeader(data, size, db_name, empty)) return(false);
+  if(empty) return(true);
+
+  return(mappedRecordList(false));
+}
+
+// Read the database from a memory mapped file on multiple threads
+bool DatabaseFileReader::ReadMappedParallel(const char *data, qint64 size, QString &db_name,
+                                            QVector<PaperMeta> *database, int shards)
+{
+  targetDatabase = database;
+
+  bool empty;
+  if(!mappedHeader(data, size, db_name, empty)) return(false);
+  if(empty) return(true);
+
+  // Pre-scan for shard boundaries: aim for shards of equal size and move each boundary forward
+  // to the start of the next record. Markup characters are always escaped in text and attribute
+  // values so any "<record" found is the start of a record.
+
+  const char *body = mapPos;
+  qint64 body_size = mapEnd-body;
+
+  // CDATA sections, comments and processing instructions are not escaped, so a "<record" in
+  // one is not a boundary. The writer never produces them; a file edited by hand that has
+  // them is read on one thread.
+  for(const char *markup = body; (markup = std::find(markup, mapEnd, '<')) < mapEnd-1; markup++)
+  {
+    if((markup[1] == '!') || (markup[1] == '?')) return(mappedRecordList(false));
+  }
+
+  QVector<MappedShard> shard_list;
+  MappedShard shard;
+  shard.begin = body;
+  shard.result = false;
+
+  for(int s = 1; s < shards; s++)
+  {
+    const char *boundary = body+(body_size*s)/shards;
+    if(boundary < shard.begin) continue;
+
+    while(true)
+    {
+      boundary = findInMapping(boundary, mapEnd, "<record");
+      if((boundary == mapEnd) || (boundary+7 == mapEnd)) break;
+
+      char next = boundary[7];
+      if(isSpace(next) || (next == '>') || (next == '/')) break;
+      boundary += 7;
+    }
+
+    if(boundary >= mapEnd-7) break;
+    if(boundary == shard.begin) continue;
+
+    shard.end = boundary;
+    shard_list.push_back(shard);
+    shard.begin = boundary;
+  }
+
+  shard.end = mapEnd;
+  shard_list.push_back(shard);
+
+  // Parse the shards on the thread pool
+  int version = databaseFileVersion;
+  bool lazy = lazyReviews;
+  QtConcurrent::blockingMap(shard_list, [version, lazy, data](MappedShard &s)
+  {
+    DatabaseFileReader shard_reader;
+    shard_reader.databaseFileVersion = version;
+    shard_reader.lazyReviews = lazy;
+    shard_reader.mapBase = data;
+    shard_reader.targetDatabase = &s.records;
+    shard_reader.mapPos = s.begin;
+    shard_reader.mapEnd = s.end;
+    s.result = shard_reader.mappedRecordList(true);
+  });
+
+  // Merge in file order
+  qsizetype total = database->size();
+  for(int s = 0; s < shard_list.size(); s++)
+  {
+    if(!shard_list[s].result) return(false);
+    total += shard_list[s].records.size();
+  }
+
+  database->reserve(total);
+  for(int s = 0; s < shard_list.size(); s++)
+  {
+    for(PaperMeta &meta : shard_list[s].records)
+      database->push_back(std::move(meta));
+  }
+
+  return(true);
+}
+
+// Read up to and including the bibliography start tag
+bool DatabaseFileReader::mappedHeader(const char *data, qint64 size, QString &db_name, bool &empty)
+{
+  mapBase = data;
+  mapPos = data;
+  mapEnd = data+size;
+
+  // Skip UTF-8 byte order mark
+  if(mappingStartsWith(mapPos, mapEnd, "\xEF\xBB\xBF")) mapPos += 3;
+
+  // Find the bibliography
+  MappedTag tag;
+  while(true)
+  {
+    if(!mappedSkipMisc()) return(false);
+    if(!mappedStartTag(tag)) return(false);
+    if(tag.name == QLatin1String("bibliography")) break;
+    if(!tag.empty && !mappedSkipElement(tag.name)) return(false);
+  }
+
+  QString value;
+  if(mappedAttribute(tag, QLatin1String("version"), value))
+  {
+    bool result;
+    databaseFileVersion = value.toInt(&result);
+    if(!result || (databaseFileVersion > QByteArray(DATABASE_VERSION).toInt())) return(false);
+  }
+
+  if(mappedAttribute(tag, QLatin1String("name"), value))
+    db_name = value;
+
+  empty = tag.empty;
+  return(true);
+}
+
+// Read the list of records
+bool DatabaseFileReader::mappedRecordList(bool shard)
+{
+  MappedTag tag;
+
+  while(true)
+  {
+    // A shard ends with the last of its records
+    if(shard)
+    {
+      while((mapPos < mapEnd) && isSpace(*mapPos)) mapPos++;
+      if(mapPos == mapEnd) return(true);
+    }
+
+    if(!mappedSkipMisc()) return(false);
+    if(mappedAtEndTag()) return(mappedEndTag(QLatin1String("bibliography")));
+
+    if(!mappedStartTag(tag)) return(false);
+
+    if(tag.name == QLatin1String("record"))
+    {
+      if(!mappedRecord(tag)) return(false);
+    }
+    else if(!tag.empty && !mappedSkipElement(tag.name))
+      return(false);
+  }
+}
+
+// Skip character data, comments and processing instructions up to the next tag
+bool DatabaseFileReader::mappedSkipMisc()
+{
+  while(true)
+  {
+    const char *lt = static_cast<const char *>(memchr(mapPos, '<', mapEnd-mapPos));
+    if(!lt) return(false);
+    mapPos = lt;
+
+    if(mappingStartsWith(mapPos, mapEnd, "<?") || mappingStartsWith(mapPos, mapEnd, "<!--"))
+    {
+      if(!mappedSkipMarkup()) return(false);
+    }
+    else if(mappingStartsWith(mapPos, mapEnd, "<!"))
+      return(false);  // DTD or CDATA are not written to database files
+    else
+      return(true);
+  }
+}
+
+// Skip the comment or processing instruction at the read position
+bool DatabaseFileReader::mappedSkipMarkup()
+{
+  const char *markup_end;
+  if(mappingStartsWith(mapPos, mapEnd, "<?"))
+  {
+    markup_end = findInMapping(mapPos, mapEnd, "?>");
+    if(markup_end == mapEnd) return(false);
+    mapPos = markup_end+2;
+  }
+  else
+  {
+    markup_end = findInMapping(mapPos, mapEnd, "-->");
+    if(markup_end == mapEnd) return(false);
+    mapPos = markup_end+3;
+  }
+
+  return(true);
+}
+
+// Next tag in the mapping is an end tag
+bool DatabaseFileReader::mappedAtEndTag() const
+{
+  return(mappingStartsWith(mapPos, mapEnd, "</"));
+}
+
+// Read a start tag and its attributes
+bool DatabaseFileReader::mappedStartTag(MappedTag &tag)
+{
+  tag.attributes.clear();
+  tag.empty = false;
+
+  if((mapPos == mapEnd) || (*mapPos != '<')) return(false);
+  mapPos++;
+
+  const char *name_start = mapPos;
+  while((mapPos < mapEnd) && !isSpace(*mapPos) && (*mapPos != '/') && (*mapPos != '>')) mapPos++;
+  if((mapPos == mapEnd) || (mapPos == name_start)) return(false);
+  tag.name = QLatin1String(name_start, mapPos-name_start);
+
+  while(true)
+  {
+    while((mapPos < mapEnd) && isSpace(*mapPos)) mapPos++;
+    if(mapPos == mapEnd) return(false);
+
+    if(*mapPos == '>')
+    {
+      mapPos++;
+      return(true);
+    }
+
+    if(*mapPos == '/')
+    {
+      if(!mappingStartsWith(mapPos, mapEnd, "/>")) return(false);
+      mapPos += 2;
+      tag.empty = true;
+      return(true);
+    }
+
+    // Attribute
+    const char *attr_start = mapPos;
+    while((mapPos < mapEnd) && !isSpace(*mapPos) && (*mapPos != '=')) mapPos++;
+    QLatin1String attr_name(attr_start, mapPos-attr_start);
+
+    while((mapPos < mapEnd) && isSpace(*mapPos)) mapPos++;
+    if((mapPos == mapEnd) || (*mapPos != '=')) return(false);
+    mapPos++;
+    while((mapPos < mapEnd) && isSpace(*mapPos)) mapPos++;
+    if((mapPos == mapEnd) || ((*mapPos != '"') && (*mapPos != '\''))) return(false);
+
+    char quote = *mapPos++;
+    const char *value_end = static_cast<const char *>(memchr(mapPos, quote, mapEnd-mapPos));
+    if(!value_end) return(false);
+
+    tag.attributes.append(qMakePair(attr_name, QLatin1String(mapPos, value_end-mapPos)));
+    mapPos = value_end+1;
+  }
+}
+
+// Read the end tag for the given element
+bool DatabaseFileReader::mappedEndTag(QLatin1String name)
+{
+  if(!mappedAtEndTag()) return(false);
+  mapPos += 2;
+
+  if((mapEnd-mapPos < name.size()) || (memcmp(mapPos, name.data(), name.size()) != 0)) return(false);
+  mapPos += name.size();
+
+  while((mapPos < mapEnd) && isSpace(*mapPos)) mapPos++;
+  if((mapPos == mapEnd) || (*mapPos != '>')) return(false);
+  mapPos++;
+
+  return(true);
+}
+
+// Read the text content of the current element, including its end tag
+bool DatabaseFileReader::mappedElementText(QLatin1String name, QString &text)
+{
+  text.clear();
+
+  while(true)
+  {
+    const char *lt = static_cast<const char *>(memchr(mapPos, '<', mapEnd-mapPos));
+    if(!lt) return(false);
+
+    if(lt > mapPos)
+    {
+      if(text.isEmpty())
+        text = arenaText(mapPos, lt);
+      else
+        text.append(DecodeText(mapPos, lt));
+    }
+    mapPos = lt;
+
+    if(mappedAtEndTag())
+      return(mappedEndTag(name));
+
+    if(mappingStartsWith(mapPos, mapEnd, "<![CDATA["))
+    {
+      const char *cdata_start = mapPos+9;
+      const char *cdata_end = findInMapping(cdata_start, mapEnd, "]]>");
+      if(cdata_end == mapEnd) return(false);
+
+      QString cdata = QString::fromUtf8(cdata_start, cdata_end-cdata_start);
+      cdata.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+      text.append(cdata);
+      mapPos = cdata_end+3;
+    }
+    else if(mappingStartsWith(mapPos, mapEnd, "<!--") || mappingStartsWith(mapPos, mapEnd, "<?"))
+    {
+      if(!mappedSkipMarkup()) return(false);
+    }
+    else
+      return(false);  // Text elements do not contain other elements
+  }
+}
+
+// Skip the current element and everything inside it
+bool DatabaseFileReader::mappedSkipElement(QLatin1String name)
+{
+  int depth = 1;
+  MappedTag tag;
+
+  while(depth > 0)
+  {
+    const char *lt = static_cast<const char *>(memchr(mapPos, '<', mapEnd-mapPos));
+    if(!lt) return(false);
+    mapPos = lt;
+
+    if(mappedAtEndTag())
+    {
+      const char *gt = static_cast<const char *>(memchr(mapPos, '>', mapEnd-mapPos));
+      if(!gt) return(false);
+      mapPos = gt+1;
+      depth--;
+    }
+    else if(mappingStartsWith(mapPos, mapEnd, "<![CDATA["))
+    {
+      const char *cdata_end = findInMapping(mapPos, mapEnd, "]]>");
+      if(cdata_end == mapEnd) return(false);
+      mapPos = cdata_end+3;
+    }
+    else if(mappingStartsWith(mapPos, mapEnd, "<!--") || mappingStartsWith(mapPos, mapEnd, "<?"))
+    {
+      if(!mappedSkipMarkup()) return(false);
+    }
+    else
+    {
+      if(!mappedStartTag(tag)) return(false);
+      if(!tag.empty) depth++;
+    }
+  }
+
+  Q_UNUSED(name);
+  return(true);
+}
+
+// Read a record from the mapping
+bool DatabaseFileReader::mappedRecord(const MappedTag &tag)
+{
+  record.Clear();
+
+  // Citation, and the fields stored as attributes in version 2 files
+  for(int a = 0; a < tag.attributes.size(); a++)
+  {
+    const QLatin1String &name = tag.attributes[a].first;
+    const QLatin1String &raw = tag.attributes[a].second;
+
+    if(name == QLatin1String("citation"))
+    {
+      record.citation = arenaText(raw.data(), raw.data()+raw.size());
+      continue;
+    }
+
+    RecordField field = recordField(name);
+    if(QString *text = textField(field))
+      *text = arenaText(raw.data(), raw.data()+raw.size());
+    else
+      setNumberField(field, mappedNumber(raw));
+  }
+
+  if(!tag.empty)
+  {
+    MappedTag field;
+
+    while(true)
+    {
+      if(!mappedSkipMisc()) return(false);
+      if(mappedAtEndTag())
+      {
+        if(!mappedEndTag(QLatin1String("record"))) return(false);
+        break;
+      }
+
+      if(!mappedStartTag(field)) return(false);
+      if(!mappedPaperField(field)) return(false);
+    }
+  }
+
+  // Store in the database
+  targetDatabase->push_back(record);
+
+  return(true);
+}
+
+// Read a field describing the paper
+bool DatabaseFileReader::mappedPaperField(const MappedTag &field)
+{
+  const QLatin1String &name = field.name;
+  RecordField id = recordField(name);
+
+  // Flags and nested elements
+  if(id == RecordField::Reviewed)
+  {
+    record.reviewed = true;
+    return(field.empty || mappedSkipElement(name));
+  }
+
+  if((id == RecordField::Reader) || (id == RecordField::Reviewer))
+  {
+    if(field.empty) return(true);
+
+    bool reader_meta = (id == RecordField::Reader);
+    MappedTag child;
+
+    while(true)
+    {
+      if(!mappedSkipMisc()) return(false);
+      if(mappedAtEndTag()) return(mappedEndTag(name));
+      if(!mappedStartTag(child)) return(false);
+
+      bool result = reader_meta ? mappedReaderField(child) : mappedReviewerField(child);
+      if(!result) return(false);
+    }
+  }
+
+  // Leave the review in the file, unless it is not plain text
+  if(lazyReviews && !field.empty && (id == RecordField::Review))
+  {
+    const char *lt = static_cast<const char *>(memchr(mapPos, '<', mapEnd-mapPos));
+    if(lt && mappingStartsWith(lt, mapEnd, "</"))
+    {
+      record.review.clear();
+      record.reviewOffset = mapPos-mapBase;
+      record.reviewLength = lt-mapPos;
+      mapPos = lt;
+      return(mappedEndTag(name));
+    }
+  }
+
+  // Text fields; the text is only decoded for fields that are kept
+  if(QString *target = textField(id))
+  {
+    if(field.empty)
+    {
+      target->clear();
+      return(true);
+    }
+    return(mappedElementText(name, *target));
+  }
+
+  if((id == RecordField::Venue) || (id == RecordField::Thesis) || (id == RecordField::ReviewDate))
+  {
+    QString text;
+    if(!field.empty && !mappedElementText(name, text)) return(false);
+
+    if(id == RecordField::Venue)
+      record.venue = venueFromText(text);
+    else if(id == RecordField::Thesis)
+      record.thesis = thesisFromText(text);
+    else
+      record.reviewDate = QDate::fromString(text);
+
+    return(true);
+  }
+
+  // Unknown element
+  return(field.empty || mappedSkipElement(name));
+}
+
+// Read a field describing the readers opinion
+bool DatabaseFileReader::mappedReaderField(const MappedTag &field)
+{
+  const QLatin1String &name = field.name;
+  RecordField id = recordField(name);
+
+  if(id == RecordField::Finished)
+  {
+    record.reader.finished = true;
+    return(field.empty || mappedSkipElement(name));
+  }
+
+  if(field.empty) return(true);
+
+  if((id == RecordField::Understanding) || (id == RecordField::Rating))
+  {
+    const char *lt = static_cast<const char *>(memchr(mapPos, '<', mapEnd-mapPos));
+    if(!lt) return(false);
+
+    // Scores are plain numbers and are converted without a string
+    setNumberField(id, mappedNumber(QLatin1String(mapPos, lt-mapPos)));
+    mapPos = lt;
+    return(mappedEndTag(name));
+  }
+
+  return(mappedSkipElement(name));
+}
+
+// Read a field describing the reviewers opinion
+bool DatabaseFileReader::mappedReviewerField(const MappedTag &field)
+{
+  const QLatin1String &name = field.name;
+  RecordField id = recordField(name);
+
+  if(id == RecordField::Corrections)
+  {
+    record.reviewer.correctionsRequired = true;
+    return(field.empty || mappedSkipElement(name));
+  }
+
+  if(field.empty) return(true);
+
+  switch(id)
+  {
+    case RecordField::AuthorComments:
+    case RecordField::EditorComments:
+    return(mappedElementText(name, *textField(id)));
+
+    case RecordField::Suitability:
+    case RecordField::Correctness:
+    case RecordField::Novelty:
+    case RecordField::Clarity:
+    case RecordField::Relevance:
+    {
+      const char *lt = static_cast<const char *>(memchr(mapPos, '<', mapEnd-mapPos));
+      if(!lt) return(false);
+
+      setNumberField(id, mappedNumber(QLatin1String(mapPos, lt-mapPos)));
+      mapPos = lt;
+      return(mappedEndTag(name));
+    }
+
+    case RecordField::Accept:
+    {
+      QString text;
+      if(!mappedElementText(name, text)) return(false);
+
+      record.reviewer.accept = acceptFromText(text);
+      return(true);
+    }
+
+    default:
+    return(mappedSkipElement(name));
+  }
+}
+
+// Get the decoded value of an attribute, returns false if not present
+bool DatabaseFileReader::mappedAttribute(const MappedTag &tag, QLatin1String name, QString &value)
+{
+  for(int a = 0; a < tag.attributes.size(); a++)
+  {
+    if(tag.attributes[a].first == name)
+    {
+      const QLatin1String &raw = tag.attributes[a].second;
+      value = DecodeText(raw.data(), raw.data()+raw.size());
+      return(true);
+    }
+  }
+
+  return(false);
+}
+
+// Convert character data from the file to a string, expanding entity references
+QString DatabaseFileReader::DecodeText(const char *begin, const char *end)
+{
+  // Most text needs no expansion and is converted straight from the mapping
+  if(!needsExpansion(begin, end))
+    return(QString::fromUtf8(begin, end-begin));
+
+  return(QString::fromUtf8(expandText(begin, end)));
+}
+
+// Convert character data from the file to a string placed in the arena
+QString DatabaseFileReader::arenaText(const char *begin, const char *end)
+{
+  if(!needsExpansion(begin, end))
+    return(arena.FromUtf8(begin, end-begin));
+
+  QByteArray plain = expandText(begin, end);
+  return(arena.FromUtf8(plain.constData(), plain.size()));
+}
+
+// Character data holds entity references or carriage returns
+bool DatabaseFileReader::needsExpansion(const char *begin, const char *end)
+{
+  return(memchr(begin, '&', end-begin) || memchr(begin, '\r', end-begin));
+}
+
+// Expand entity references and normalise line endings in character data
+QByteArray DatabaseFileReader::expandText(const char *begin, const char *end)
+{
+  QByteArray plain;
+  plain.reserve(end-begin);
+
+  const char *p = begin;
+  while(p < end)
+  {
+    if(*p == '\r')
+    {
+      // Line endings are normalised as by the XML reader
+      plain.append('\n');
+      p++;
+      if((p < end) && (*p == '\n')) p++;
+    }
+    else if(*p == '&')
+    {
+      const char *semicolon = static_cast<const char *>(memchr(p, ';', end-p));
+      if(!semicolon)
+      {
+        plain.append(p, end-p);
+        break;
+      }
+
+      QLatin1String entity(p+1, semicolon-(p+1));
+      if(entity == QLatin1String("lt"))        plain.append('<');
+      else if(entity == QLatin1String("gt"))   plain.append('>');
+      else if(entity == QLatin1String("amp"))  plain.append('&');
+      else if(entity == QLatin1String("quot")) plain.append('"');
+      else if(entity == QLatin1String("apos")) plain.append('\'');
+      else if((entity.size() > 1) && (entity.data()[0] == '#'))
+      {
+        bool ok;
+        char32_t code;
+        if((entity.data()[1] == 'x') || (entity.data()[1] == 'X'))
+          code = QByteArray(entity.data()+2, entity.size()-2).toUInt(&ok, 16);
+        else
+          code = QByteArray(entity.data()+1, entity.size()-1).toUInt(&ok, 10);
+
+        if(ok)
+          plain.append(QString::fromUcs4(&code, 1).toUtf8());
+        else
+          plain.append(p, semicolon+1-p);
+      }
+      else
+        plain.append(p, semicolon+1-p);
+
+      p = semicolon+1;
+    }
+    else
+    {
+      const char *run = p;
+      while((p < end) && (*p != '&') && (*p != '\r')) p++;
+      plain.append(run, p-run);
+    }
+  }
+
+  return(plain);
+}
@@ -11,8 +11,15 @@
 #include <QXmlStreamReader>
 #include <QString>
 #include <QVector>
+#include <QVarLengthArray>
+#include <QPair>
+#include <QLatin1String>
 
 #include "papermeta.h"
+#include "databasejournal.h"
+#include "stringarena.h"
+
+class GzipDevice;
 
 /**
  * @brief Read and parse a database file
@@ -20,24 +27,118 @@
 class DatabaseFileReader
 {
 public:
+  /// Elements and attributes of a record, looked up from their names without creating strings
+  enum class RecordField : quint8
+  {
+    Unknown,
+    Review, PaperPath, Venue, Authors, Title, Publication, Volume, Issue, Month, Year, Dates,
+    PageStart, PageEnd, URL, Thesis, Institution, Location, Publisher, ISBN, DOI, Note,
+    ReviewDate, Tags, Reviewed,
+    Reader, Finished, Understanding, Rating,
+    Reviewer, Accept, Suitability, Correctness, Novelty, Clarity, Relevance, Corrections,
+    AuthorComments, EditorComments
+  };
+
   DatabaseFileReader();
 
   /// Destructor
   ~DatabaseFileReader();
 
   /**
-   * Read the database
+   * Read the database; gzip compressed files are decompressed as they are read
    * @param device   where the database is being read from
    * @param database  the database being read to
    */
   bool Read(QIODevice *device, QString &name, QVector<PaperMeta> *database);
 
+  /**
+   * Start reading the records of a database one at a time, so that only the current
+   * record is held in memory; gzip compressed files are decompressed as they are read
+   * @param device  where the database is being read from, open until reading is finished
+   * @param name    name of the database
+   */
+  bool Open(QIODevice *device, QString &name);
+
+  /**
+   * Read the next record after Open()
+   * @param meta  set to the record
+   * @return false at the end of the records or if an error stopped reading, see HasError()
+   */
+  bool ReadNext(PaperMeta &meta);
+
+  /// Reading stopped with an error
+  bool HasError() const;
+
+  /**
+   * Read the database directly from a memory mapped file; strings are only created
+   * for the fields that are kept in the records
+   * @param data      start of the mapped file
+   * @param size      number of bytes in the mapping
+   * @param name      name of the database
+   * @param database  the database being read to
+   * @return false if the file could not be parsed, the caller should then use Read()
+   */
+  bool ReadMapped(const char *data, qint64 size, QString &name, QVector<PaperMeta> *database);
+
+  /**
+   * Read the database from a memory mapped file on multiple threads. A quick scan finds
+   * record boundaries, shards of records are parsed on the global thread pool and then
+   * merged in file order. A file with CDATA sections or comments is read on one thread.
+   * @param shards  number of shards to divide the records between
+   * @return false if the file could not be parsed, the caller should then use Read()
+   */
+  bool ReadMappedParallel(const char *data, qint64 size, QString &name, QVector<PaperMeta> *database, int shards);
+
+  /**
+   * Leave review text in the mapped file; each record gets the offset and length of
+   * its review instead so that it can be fetched later with DecodeText()
+   */
+  void SetLazyReviews(bool lazy) { lazyReviews = lazy; }
+
+  /**
+   * Read the changes in a database journal
+   * @param device   where the journal is being read from
+   * @param changes  complete changes are appended here
+   */
+  bool ReadJournal(QIODevice *device, QVector<DatabaseChange> *changes);
+
+  /// Convert character data from the file to a string, expanding entity references
+  static QString DecodeText(const char *begin, const char *end);
+
 private:
-  /// Read the list of records
-  void readRecordList();
+  /// Element tag read from a mapped file; the views point into the mapping
+  struct MappedTag
+  {
+    QLatin1String name;                ///< Element name
+    bool          empty;               ///< Tag was closed with "/>"
+
+    /// Attribute names and their undecoded values
+    QVarLengthArray<QPair<QLatin1String, QLatin1String>, 4> attributes;
+  };
 
-  /// Read the basic record info
-  void readRecordDetails();
+  /// Range of a mapped file holding whole records, parsed by one thread
+  struct MappedShard
+  {
+    const char        *begin;          ///< Start of first record
+    const char        *end;            ///< End of the shard
+    QVector<PaperMeta> records;        ///< Records read from the shard
+    bool               result;         ///< Shard was read successfully
+  };
+
+  /// Read up to and including the bibliography start tag
+  bool mappedHeader(const char *data, qint64 size, QString &name, bool &empty);
+
+  /// Read the list of records; a shard stops at the end of the mapping
+  bool mappedRecordList(bool shard);
+
+  /// Read the citation and the fields stored as attributes of a version 2 record
+  void readRecordAttributes();
+
+  /// String of the current record holding a text field, or nullptr
+  QString *textField(RecordField field);
+
+  /// Set a field of the current record that is stored as a number in version 2 files
+  void setNumberField(RecordField field, int value);
 
   /// Read meta data describing the paper
   void readPaperMeta();
@@ -48,6 +149,51 @@ private:
   /// Read meta data describing the reviewers opinion
   void readReviewerMeta();
 
+  /// Skip character data, comments and processing instructions up to the next tag
+  bool mappedSkipMisc();
+
+  /// Skip the comment or processing instruction at the read position
+  bool mappedSkipMarkup();
+
+  /// Next tag in the mapping is an end tag
+  bool mappedAtEndTag() const;
+
+  /// Read a start tag and its attributes
+  bool mappedStartTag(MappedTag &tag);
+
+  /// Read the end tag for the given element
+  bool mappedEndTag(QLatin1String name);
+
+  /// Read the text content of the current element, including its end tag
+  bool mappedElementText(QLatin1String name, QString &text);
+
+  /// Skip the current element and everything inside it
+  bool mappedSkipElement(QLatin1String name);
+
+  /// Read a record from the mapping
+  bool mappedRecord(const MappedTag &tag);
+
+  /// Read a field describing the paper
+  bool mappedPaperField(const MappedTag &field);
+
+  /// Read a field describing the readers opinion
+  bool mappedReaderField(const MappedTag &field);
+
+  /// Read a field describing the reviewers opinion
+  bool mappedReviewerField(const MappedTag &field);
+
+  /// Get the decoded value of an attribute, returns false if not present
+  static bool mappedAttribute(const MappedTag &tag, QLatin1String name, QString &value);
+
+  /// Convert character data from the file to a string placed in the arena, as DecodeText()
+  QString arenaText(const char *begin, const char *end);
+
+  /// Character data holds entity references or carriage returns that DecodeText() expands
+  static bool needsExpansion(const char *begin, const char *end);
+
+  /// Expand entity references and normalise line endings in character data, which stays UTF-8
+  static QByteArray expandText(const char *begin, const char *end);
+
   bool        databaseStarted;        ///< Reading has started
   int         databaseFileVersion;    ///< Version of the database file
   PaperMeta   record;                 ///< Current record/review being read
@@ -57,6 +203,17 @@ private:
 
   /// The low level reader
   QXmlStreamReader reader;
+
+  /// Decompresses the device being read, if it is compressed
+  GzipDevice *gzip;
+
+  const char *mapBase;                ///< Start of the mapped file
+  const char *mapPos;                 ///< Read position in the mapped file
+  const char *mapEnd;                 ///< End of the mapped file
+  bool        lazyReviews;            ///< Record review offsets instead of the text
+
+  /// Strings of records read from a mapped file are placed here
+  StringArena arena;
 };
 
 #endif  // DATABASEFILEREADER_H
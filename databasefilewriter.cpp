@@ -5,195 +5,397 @@
  * @date   2021.01.09
  */
 
-#include <QFile>
+#include <QSaveFile>
 #include <QXmlStreamWriter>
 
 #include "databasefilewriter.h"
+#include "gzipdevice.h"
 
 // Constructor
 DatabaseFileWriter::DatabaseFileWriter() : version(DATABASE_VERSION)
 {
+  output = nullptr;
+  gzip = nullptr;
+  stream = nullptr;
+  device = nullptr;
+}
+
+// Destructor
+DatabaseFileWriter::~DatabaseFileWriter()
+{
+  release();
 }
 
 // Save a paper database
 bool DatabaseFileWriter::Save(const QString &filename, const QString &name, const QVector<PaperMeta> &records)
 {
-  QFile output(filename);
-  if(!output.open(QIODevice::WriteOnly | QIODevice::Text))
-    return(false);
-
-  QXmlStreamWriter stream(&output);
-  stream.setAutoFormatting(true);
-  stream.writeStartDocument();
-
-  stream.writeStartElement("bibliography");
-  stream.writeAttribute("version", version);
-  stream.writeAttribute("name", name);          // Write database name
+  if(!Open(filename, name)) return(false);
 
   // Write metadata for all papers
   for(int r = 0; r < records.size(); r++)
   {
-    stream.writeStartElement("record");
-    stream.writeAttribute("citation", records[r].citation);
+    if(!Write(records[r]))
+    {
+      release();
+      return(false);
+    }
+  }
 
-    if(!records[r].paperPath.isEmpty())
-      stream.writeTextElement("paperPath", records[r].paperPath);
+  return(Close());
+}
 
-    if(!records[r].review.isEmpty())
-      stream.writeTextElement("review", records[r].review);
+// Start writing a database file one record at a time
+bool DatabaseFileWriter::Open(const QString &filename, const QString &name)
+{
+  release();
 
-    switch(records[r].venue)
-    {
-      case VenueType::Journal:       stream.writeTextElement("venue", "Journal");       break;
-      case VenueType::Conference:    stream.writeTextElement("venue", "Conference");    break;
-      case VenueType::Symposium:     stream.writeTextElement("venue", "Symposium");     break;
-      case VenueType::Book:          stream.writeTextElement("venue", "Book");          break;
-      case VenueType::Preprint:      stream.writeTextElement("venue", "Preprint");      break;
-      case VenueType::Thesis:        stream.writeTextElement("venue", "Thesis");        break;
-      case VenueType::Report:        stream.writeTextElement("venue", "Report");        break;
-      case VenueType::SelfPublished: stream.writeTextElement("venue", "SelfPublished"); break;
-      case VenueType::NotPublished:  stream.writeTextElement("venue", "NotPublished");  break;
-      case VenueType::NoVenue:       stream.writeTextElement("venue", "None");          break;
-      case VenueType::UnknownVenue:  stream.writeTextElement("venue", "Unknown");       break;
-    }
+  // The file is replaced only once it has been completely written
+  output = new QSaveFile(filename);
+  bool compressed = filename.endsWith(DATABASE_COMPRESSED_EXTENSION);
+  if(!output->open(compressed ? QIODevice::WriteOnly : (QIODevice::WriteOnly | QIODevice::Text)))
+  {
+    release();
+    return(false);
+  }
 
-    if(!records[r].authors.isEmpty())
-      stream.writeTextElement("authors", records[r].authors);
-    if(!records[r].title.isEmpty())
-      stream.writeTextElement("title", records[r].title);
-    if(!records[r].publication.isEmpty())
-      stream.writeTextElement("publication", records[r].publication);
-
-    if(!records[r].volume.isEmpty())
-      stream.writeTextElement("volume", records[r].volume);
-    if(!records[r].issue.isEmpty())
-      stream.writeTextElement("issue", records[r].issue);
-    if(!records[r].month.isEmpty())
-      stream.writeTextElement("month", records[r].month);
-    if(!records[r].year.isEmpty())
-      stream.writeTextElement("year", records[r].year);
-    if(!records[r].dates.isEmpty())
-      stream.writeTextElement("dates", records[r].dates);
-
-    if(!records[r].pageStart.isEmpty())
-      stream.writeTextElement("pageStart", records[r].pageStart);
-    if(!records[r].pageEnd.isEmpty())
-      stream.writeTextElement("pageEnd", records[r].pageEnd);
-
-    if(!records[r].URL.isEmpty())
-      stream.writeTextElement("url", records[r].URL);
-
-    if(records[r].venue == VenueType::Thesis)
+  // Compressed files are deflated as they are written
+  device = output;
+  if(compressed)
+  {
+    gzip = new GzipDevice(output);
+    if(!gzip->open(QIODevice::WriteOnly))
     {
-      switch(records[r].thesis)
-      {
-        case ThesisType::Doctorate:         stream.writeTextElement("thesis", "Doctorate"); break;
-        case ThesisType::Masters:           stream.writeTextElement("thesis", "Masters");   break;
-        case ThesisType::Bachelors:         stream.writeTextElement("thesis", "Bachelors"); break;
-        case ThesisType::College:           stream.writeTextElement("thesis", "College");   break;
-        case ThesisType::UnknownThesisType: stream.writeTextElement("thesis", "Unknown");   break;
-      }
+      release();
+      return(false);
     }
+    device = gzip;
+  }
 
-    if(!records[r].institution.isEmpty())
-      stream.writeTextElement("institution", records[r].institution);
+  stream = new QXmlStreamWriter(device);
+  stream->setAutoFormatting(true);
+  stream->writeStartDocument();
 
-    if(!records[r].location.isEmpty())
-      stream.writeTextElement("location", records[r].location);
+  stream->writeStartElement("bibliography");
+  stream->writeAttribute("version", version);
+  stream->writeAttribute("name", name);         // Write database name
+  stream->writeCharacters("\n");                // Close the start tag before writing encoded records
+
+  return(!stream->hasError());
+}
 
-    if(!records[r].publisher.isEmpty())
-      stream.writeTextElement("publisher", records[r].publisher);
+// Write the next record
+bool DatabaseFileWriter::Write(const PaperMeta &record)
+{
+  if(!stream) return(false);
+
+  // Files for older versions of the program are written in the version 1 format; records
+  // encoded by a previous save are copied as they are
+  if(version == "1")
+    writeRecordVersion1(*stream, record);
+  else if(!record.xmlFragment.isEmpty())
+    device->write(record.xmlFragment);
+  else
+    device->write(EncodeRecord(record));
+
+  return(!stream->hasError());
+}
 
-    if(!records[r].ISBN.isEmpty())
-      stream.writeTextElement("ISBN", records[r].ISBN);
+// Finish the file and replace any existing one
+bool DatabaseFileWriter::Close()
+{
+  if(!stream) return(false);
 
-    if(!records[r].doi.isEmpty())
-      stream.writeTextElement("DOI", records[r].doi);
+  stream->writeEndElement(); // bibliography
+  stream->writeEndDocument();
 
-    if(!records[r].note.isEmpty())
-      stream.writeTextElement("note", records[r].note);
+  bool result = !stream->hasError();
 
-    if(records[r].reviewDate.isValid())
-      stream.writeTextElement("reviewDate", records[r].reviewDate.toString());
+  if(gzip)
+  {
+    gzip->close();
+    if(gzip->HasError()) result = false;
+  }
 
-    if(!records[r].tags.isEmpty())
-      stream.writeTextElement("tags", records[r].tags);
+  if(result) result = output->commit();
 
-    if(records[r].reviewed)
-      stream.writeEmptyElement("reviewed");
+  release();
 
-    // Reader opinion
-    if((!records[r].reader.finished) || (records[r].reader.understanding > 1) || (records[r].reader.rating > 1))
-    {
-      stream.writeStartElement("reader");
-      if(records[r].reader.finished)
-        stream.writeEmptyElement("finished");
+  return(result);
+}
 
-      stream.writeTextElement("understanding", QString::number(records[r].reader.understanding));
-      stream.writeTextElement("rating", QString::number(records[r].reader.rating));
+// Discard the file being written
+void DatabaseFileWriter::release()
+{
+  // A save file that was not committed leaves any existing file alone
+  delete stream;
+  delete gzip;
+  delete output;
+
+  stream = nullptr;
+  gzip = nullptr;
+  output = nullptr;
+  device = nullptr;
+}
 
-      stream.writeEndElement(); // reader
-    }
+// Write one record; short scalar fields are attributes holding numbers
+void DatabaseFileWriter::WriteRecord(QXmlStreamWriter &stream, const PaperMeta &record)
+{
+  stream.writeStartElement("record");
+  stream.writeAttribute("citation", record.citation);
+
+  // Fields with their default value are left out
+  if(record.venue != VenueType::UnknownVenue)
+    stream.writeAttribute("venue", QString::number(static_cast<int>(record.venue)));
+  if(record.venue == VenueType::Thesis)
+    stream.writeAttribute("thesis", QString::number(static_cast<int>(record.thesis)));
+
+  if(!record.year.isEmpty())
+    stream.writeAttribute("year", record.year);
+  if(!record.month.isEmpty())
+    stream.writeAttribute("month", record.month);
+  if(!record.volume.isEmpty())
+    stream.writeAttribute("volume", record.volume);
+  if(!record.issue.isEmpty())
+    stream.writeAttribute("issue", record.issue);
+  if(!record.pageStart.isEmpty())
+    stream.writeAttribute("pageStart", record.pageStart);
+  if(!record.pageEnd.isEmpty())
+    stream.writeAttribute("pageEnd", record.pageEnd);
+
+  if(record.reviewDate.isValid())
+    stream.writeAttribute("reviewDate", QString::number(record.reviewDate.toJulianDay()));
+  if(record.reviewed)
+    stream.writeAttribute("reviewed", "1");
+
+  // Reader opinion
+  if(record.reader.finished)
+    stream.writeAttribute("finished", "1");
+  if(record.reader.understanding != 1)
+    stream.writeAttribute("understanding", QString::number(record.reader.understanding));
+  if(record.reader.rating != 1)
+    stream.writeAttribute("rating", QString::number(record.reader.rating));
+
+  // Review
+  if(record.reviewer.accept != Accept_Neutral)
+    stream.writeAttribute("accept", QString::number(record.reviewer.accept));
+  if(record.reviewer.suitability != 1)
+    stream.writeAttribute("suitability", QString::number(record.reviewer.suitability));
+  if(record.reviewer.technicalCorrectness != 1)
+    stream.writeAttribute("correctness", QString::number(record.reviewer.technicalCorrectness));
+  if(record.reviewer.novelty != 1)
+    stream.writeAttribute("novelty", QString::number(record.reviewer.novelty));
+  if(record.reviewer.clarity != 1)
+    stream.writeAttribute("clarity", QString::number(record.reviewer.clarity));
+  if(record.reviewer.relevance != 1)
+    stream.writeAttribute("relevance", QString::number(record.reviewer.relevance));
+  if(record.reviewer.correctionsRequired)
+    stream.writeAttribute("corrections", "1");
+
+  // Text fields are elements
+  if(!record.paperPath.isEmpty())
+    stream.writeTextElement("paperPath", record.paperPath);
+  if(!record.review.isEmpty())
+    stream.writeTextElement("review", record.review);
+  if(!record.authors.isEmpty())
+    stream.writeTextElement("authors", record.authors);
+  if(!record.title.isEmpty())
+    stream.writeTextElement("title", record.title);
+  if(!record.publication.isEmpty())
+    stream.writeTextElement("publication", record.publication);
+  if(!record.dates.isEmpty())
+    stream.writeTextElement("dates", record.dates);
+  if(!record.URL.isEmpty())
+    stream.writeTextElement("url", record.URL);
+  if(!record.institution.isEmpty())
+    stream.writeTextElement("institution", record.institution);
+  if(!record.location.isEmpty())
+    stream.writeTextElement("location", record.location);
+  if(!record.publisher.isEmpty())
+    stream.writeTextElement("publisher", record.publisher);
+  if(!record.ISBN.isEmpty())
+    stream.writeTextElement("ISBN", record.ISBN);
+  if(!record.doi.isEmpty())
+    stream.writeTextElement("DOI", record.doi);
+  if(!record.note.isEmpty())
+    stream.writeTextElement("note", record.note);
+  if(!record.tags.isEmpty())
+    stream.writeTextElement("tags", record.tags);
+  if(!record.reviewer.commentsToAuthors.isEmpty())
+    stream.writeTextElement("authorComments", record.reviewer.commentsToAuthors);
+  if(!record.reviewer.commentsToChairEditor.isEmpty())
+    stream.writeTextElement("editorComments", record.reviewer.commentsToChairEditor);
+
+  stream.writeEndElement(); // record
+}
 
-    // Review
-    if((records[r].reviewer.accept != Accept_Neutral) || (records[r].reviewer.correctionsRequired) ||
-       (records[r].reviewer.suitability > 1) || (records[r].reviewer.technicalCorrectness > 1) ||
-       (records[r].reviewer.novelty > 1) || (records[r].reviewer.clarity > 1) || (records[r].reviewer.relevance > 1) ||
-       (!records[r].reviewer.commentsToAuthors.isEmpty()) || (!records[r].reviewer.commentsToChairEditor.isEmpty()))
+// Encode one record as it is written to the database file
+QByteArray DatabaseFileWriter::EncodeRecord(const PaperMeta &record)
+{
+  QByteArray fragment;
+
+  QXmlStreamWriter stream(&fragment);
+  WriteRecord(stream, record);
+  fragment.append('\n');
+
+  return(fragment);
+}
+
+// Write one record in the version 1 format
+void DatabaseFileWriter::writeRecordVersion1(QXmlStreamWriter &stream, const PaperMeta &record)
+{
+  stream.writeStartElement("record");
+  stream.writeAttribute("citation", record.citation);
+
+  if(!record.paperPath.isEmpty())
+    stream.writeTextElement("paperPath", record.paperPath);
+
+  if(!record.review.isEmpty())
+    stream.writeTextElement("review", record.review);
+
+  switch(record.venue)
+  {
+    case VenueType::Journal:       stream.writeTextElement("venue", "Journal");       break;
+    case VenueType::Conference:    stream.writeTextElement("venue", "Conference");    break;
+    case VenueType::Symposium:     stream.writeTextElement("venue", "Symposium");     break;
+    case VenueType::Book:          stream.writeTextElement("venue", "Book");          break;
+    case VenueType::Preprint:      stream.writeTextElement("venue", "Preprint");      break;
+    case VenueType::Thesis:        stream.writeTextElement("venue", "Thesis");        break;
+    case VenueType::Report:        stream.writeTextElement("venue", "Report");        break;
+    case VenueType::SelfPublished: stream.writeTextElement("venue", "SelfPublished"); break;
+    case VenueType::NotPublished:  stream.writeTextElement("venue", "NotPublished");  break;
+    case VenueType::NoVenue:       stream.writeTextElement("venue", "None");          break;
+    case VenueType::UnknownVenue:  stream.writeTextElement("venue", "Unknown");       break;
+  }
+
+  if(!record.authors.isEmpty())
+    stream.writeTextElement("authors", record.authors);
+  if(!record.title.isEmpty())
+    stream.writeTextElement("title", record.title);
+  if(!record.publication.isEmpty())
+    stream.writeTextElement("publication", record.publication);
+
+  if(!record.volume.isEmpty())
+    stream.writeTextElement("volume", record.volume);
+  if(!record.issue.isEmpty())
+    stream.writeTextElement("issue", record.issue);
+  if(!record.month.isEmpty())
+    stream.writeTextElement("month", record.month);
+  if(!record.year.isEmpty())
+    stream.writeTextElement("year", record.year);
+  if(!record.dates.isEmpty())
+    stream.writeTextElement("dates", record.dates);
+
+  if(!record.pageStart.isEmpty())
+    stream.writeTextElement("pageStart", record.pageStart);
+  if(!record.pageEnd.isEmpty())
+    stream.writeTextElement("pageEnd", record.pageEnd);
+
+  if(!record.URL.isEmpty())
+    stream.writeTextElement("url", record.URL);
+
+  if(record.venue == VenueType::Thesis)
+  {
+    switch(record.thesis)
     {
-      stream.writeStartElement("reviewer");
+      case ThesisType::Doctorate:         stream.writeTextElement("thesis", "Doctorate"); break;
+      case ThesisType::Masters:           stream.writeTextElement("thesis", "Masters");   break;
+      case ThesisType::Bachelors:         stream.writeTextElement("thesis", "Bachelors"); break;
+      case ThesisType::College:           stream.writeTextElement("thesis", "College");   break;
+      case ThesisType::UnknownThesisType: stream.writeTextElement("thesis", "Unknown");   break;
+    }
+  }
 
-      switch(records[r].reviewer.accept)
-      {
-        case Accept_Strong:
-        stream.writeTextElement("accept", "AcceptStrong");
-        break;
+  if(!record.institution.isEmpty())
+    stream.writeTextElement("institution", record.institution);
 
-        case Accept_Weak:
-        stream.writeTextElement("accept", "AcceptWeak");
-        break;
+  if(!record.location.isEmpty())
+    stream.writeTextElement("location", record.location);
 
-        case Accept_Neutral:
-        stream.writeTextElement("accept", "AcceptNeutral");
-        break;
+  if(!record.publisher.isEmpty())
+    stream.writeTextElement("publisher", record.publisher);
 
-        case Reject_Weak:
-        stream.writeTextElement("accept", "RejectWeak");
-        break;
+  if(!record.ISBN.isEmpty())
+    stream.writeTextElement("ISBN", record.ISBN);
 
-        case Reject_Strong:
-        stream.writeTextElement("accept", "RejectStrong");
-        break;
+  if(!record.doi.isEmpty())
+    stream.writeTextElement("DOI", record.doi);
 
+  if(!record.note.isEmpty())
+    stream.writeTextElement("note", record.note);
 
-      }
+  if(record.reviewDate.isValid())
+    stream.writeTextElement("reviewDate", record.reviewDate.toString());
 
-      stream.writeTextElement("suitability", QString::number(records[r].reviewer.suitability));
-      stream.writeTextElement("correctness", QString::number(records[r].reviewer.technicalCorrectness));
-      stream.writeTextElement("novelty",     QString::number(records[r].reviewer.novelty));
-      stream.writeTextElement("clarity",     QString::number(records[r].reviewer.clarity));
-      stream.writeTextElement("relevance",   QString::number(records[r].reviewer.relevance));
+  if(!record.tags.isEmpty())
+    stream.writeTextElement("tags", record.tags);
 
-      if(records[r].reviewer.correctionsRequired)
-        stream.writeEmptyElement("corrections");
+  if(record.reviewed)
+    stream.writeEmptyElement("reviewed");
 
-      if(!records[r].reviewer.commentsToAuthors.isEmpty())
-        stream.writeTextElement("authorComments", records[r].reviewer.commentsToAuthors);
+  // Reader opinion
+  if((!record.reader.finished) || (record.reader.understanding > 1) || (record.reader.rating > 1))
+  {
+    stream.writeStartElement("reader");
+    if(record.reader.finished)
+      stream.writeEmptyElement("finished");
+
+    stream.writeTextElement("understanding", QString::number(record.reader.understanding));
+    stream.writeTextElement("rating", QString::number(record.reader.rating));
+
+    stream.writeEndElement(); // reader
+  }
+
+  // Review
+  if((record.reviewer.accept != Accept_Neutral) || (record.reviewer.correctionsRequired) ||
+     (record.reviewer.suitability > 1) || (record.reviewer.technicalCorrectness > 1) ||
+     (record.reviewer.novelty > 1) || (record.reviewer.clarity > 1) || (record.reviewer.relevance > 1) ||
+     (!record.reviewer.commentsToAuthors.isEmpty()) || (!record.reviewer.commentsToChairEditor.isEmpty()))
+  {
+    stream.writeStartElement("reviewer");
+
+    switch(record.reviewer.accept)
+    {
+      case Accept_Strong:
+      stream.writeTextElement("accept", "AcceptStrong");
+      break;
+
+      case Accept_Weak:
+      stream.writeTextElement("accept", "AcceptWeak");
+      break;
+
+      case Accept_Neutral:
+      stream.writeTextElement("accept", "AcceptNeutral");
+      break;
+
+      case Reject_Weak:
+      stream.writeTextElement("accept", "RejectWeak");
+      break;
+
+      case Reject_Strong:
+      stream.writeTextElement("accept", "RejectStrong");
+      break;
 
-      if(!records[r].reviewer.commentsToChairEditor.isEmpty())
-        stream.writeTextElement("editorComments", records[r].reviewer.commentsToChairEditor);
 
-      stream.writeEndElement(); // reviewer
     }
 
-    // all data is stored in review...
-    stream.writeEndElement(); // record
-  }
+    stream.writeTextElement("suitability", QString::number(record.reviewer.suitability));
+    stream.writeTextElement("correctness", QString::number(record.reviewer.technicalCorrectness));
+    stream.writeTextElement("novelty",     QString::number(record.reviewer.novelty));
+    stream.writeTextElement("clarity",     QString::number(record.reviewer.clarity));
+    stream.writeTextElement("relevance",   QString::number(record.reviewer.relevance));
 
-  stream.writeEndElement(); // bibliography
-  stream.writeEndDocument();
+    if(record.reviewer.correctionsRequired)
+      stream.writeEmptyElement("corrections");
 
-  output.close();
+    if(!record.reviewer.commentsToAuthors.isEmpty())
+      stream.writeTextElement("authorComments", record.reviewer.commentsToAuthors);
+
+    if(!record.reviewer.commentsToChairEditor.isEmpty())
+      stream.writeTextElement("editorComments", record.reviewer.commentsToChairEditor);
+
+    stream.writeEndElement(); // reviewer
+  }
 
-  return(true);
+  // all data is stored in review...
+  stream.writeEndElement(); // record
 }
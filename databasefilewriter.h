@@ -10,10 +10,17 @@
 
 #include <QString>
 #include <QVector>
+#include <QXmlStreamWriter>
 
 #include "papermeta.h"
 
-#define DATABASE_VERSION "1"
+class QSaveFile;
+class GzipDevice;
+
+/// Newest version of the file format, the one read fastest
+#define DATABASE_VERSION "2"
+/// Version every release of the program can read, written until the newer one is chosen
+#define DATABASE_VERSION_COMPATIBLE "1"
 
 /// Write a database file
 class DatabaseFileWriter
@@ -22,16 +29,54 @@ public:
   /// Constructor
   DatabaseFileWriter();
 
+  /// Destructor, discards a file that was not closed
+  ~DatabaseFileWriter();
+
+  Q_DISABLE_COPY(DatabaseFileWriter)
+
   /**
    * Save a database to a file
-   * @param filename   full path and name to save to; usually with .rodb extension
+   * @param filename   full path and name to save to; usually with .rodb extension, or .rodb.gz
+   *                   to compress the file
    * @param name       the name of the database
    * @param records    the database to save
    */
   bool Save(const QString &filename, const QString &name, const QVector<PaperMeta> &records);
 
-  /// Version number, as a string
+  /**
+   * Start writing a database file one record at a time, so the records need not all be
+   * held in memory; the file is only replaced once Close() succeeds
+   * @param filename  as for Save()
+   * @param name      the name of the database
+   */
+  bool Open(const QString &filename, const QString &name);
+
+  /// Write the next record after Open()
+  bool Write(const PaperMeta &record);
+
+  /// Complete the file and replace any existing file with it
+  bool Close();
+
+  /// Write one record element to the stream in the current format
+  static void WriteRecord(QXmlStreamWriter &stream, const PaperMeta &record);
+
+  /// Encode one record as it is written to the database file
+  static QByteArray EncodeRecord(const PaperMeta &record);
+
+  /// Version number, as a string; set to DATABASE_VERSION_COMPATIBLE to write files older versions of the program can read
   QString version;
+
+private:
+  /// Write one record element in the version 1 format, every field is an element
+  static void writeRecordVersion1(QXmlStreamWriter &stream, const PaperMeta &record);
+
+  /// Discard the file being written
+  void release();
+
+  QSaveFile        *output;            ///< File being written
+  GzipDevice       *gzip;              ///< Compresses the output, if the file is compressed
+  QXmlStreamWriter *stream;            ///< Writes the file's markup
+  QIODevice        *device;            ///< Device records are written to
 };
 
 #endif  // DATABASEFILEWRITER_H
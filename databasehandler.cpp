@@ -7,28 +7,110 @@
 
 #include <algorithm>
 
-#include <QFile>
+#include <QtConcurrent>
+#include <QSet>
 #include <QDebug>
 
 #include "databasehandler.h"
-#include "databasefilereader.h"
-#include "databasefilewriter.h"
+#include "xmlstorage.h"
+#include "sqlitestorage.h"
+#include "performancelog.h"
 
-// Add a database file
-bool DatabaseHandler::Load(const char *filename)
+/// String fields of PaperMeta and their names, for the memory report
+static const struct
+{
+  const char         *name;
+  QString PaperMeta::*member;
+} recordStringFields[] =
+{
+  {"citation", &PaperMeta::citation},       {"review", &PaperMeta::review},       {"paperPath", &PaperMeta::paperPath},
+  {"authors", &PaperMeta::authors},         {"title", &PaperMeta::title},         {"publication", &PaperMeta::publication},
+  {"volume", &PaperMeta::volume},           {"issue", &PaperMeta::issue},         {"month", &PaperMeta::month},
+  {"year", &PaperMeta::year},               {"dates", &PaperMeta::dates},         {"pageStart", &PaperMeta::pageStart},
+  {"pageEnd", &PaperMeta::pageEnd},         {"URL", &PaperMeta::URL},             {"institution", &PaperMeta::institution},
+  {"location", &PaperMeta::location},       {"publisher", &PaperMeta::publisher}, {"ISBN", &PaperMeta::ISBN},
+  {"doi", &PaperMeta::doi},                 {"note", &PaperMeta::note},           {"tags", &PaperMeta::tags},
+  {"originalCitation", &PaperMeta::originalCitation}
+};
+
+/// String fields of ReviewerMeta and their names, for the memory report
+static const struct
+{
+  const char            *name;
+  QString ReviewerMeta::*member;
+} reviewerStringFields[] =
+{
+  {"commentsToAuthors", &ReviewerMeta::commentsToAuthors}, {"commentsToChairEditor", &ReviewerMeta::commentsToChairEditor}
+};
+
+// Account for a string held in a field of a record
+static void countString(FieldMemory &field, const QString &text, QSet<const void *> &buffers, QSet<QString> &values)
 {
-  DatabaseFileReader reader;
+  if(text.isEmpty()) return;
+
+  field.strings++;
+  qint64 bytes = text.size()*sizeof(QChar);
 
-  QFile input(filename);
-  if(!input.open(QIODevice::ReadOnly | QIODevice::Text))
+  // An interned value is held once however many records share it
+  if(buffers.contains(text.constData()))
   {
-    qDebug() << "Could not open file " << filename << " for reading.\n";
-    return(false);
+    field.sharedBytes += bytes;
+    return;
   }
+  buffers.insert(text.constData());
 
-  bool result = reader.Read(&input, databaseName, &database);
-  if(result)
+  // Text and terminator
+  field.bytes += bytes+sizeof(QChar);
+
+  if(values.contains(text))
+    field.duplicateBytes += bytes;
+  else
+    values.insert(text);
+}
+
+// Destructor
+DatabaseHandler::~DatabaseHandler()
+{
+  WaitForBackgroundSave();
+
+  delete storage;
+}
+
+// Add a database file
+bool DatabaseHandler::Load(const char *filename)
+{
+  // The file may be the one being written
+  WaitForBackgroundSave();
+
+  // Changes no longer go to the previous database file
+  closeStorage();
+
+  // Until the load succeeds the records are not known to match any file
+  modified = true;
+  syncedFile.clear();
+
+  StorageBackend *source = createStorage(filename);
+  int initial_size = database.size();
+
+  // The values of a database that has been replaced are no longer shared with any record
+  if(initial_size == 0) strings.Clear();
+
+  bool result = source->Load(databaseName, &database);
+
+  // The records may have been changed even if the load failed
+  indexRecords();
+
+  if(!result)
+    delete source;
+  else
   {
+    // Changes are stored in the file from now on; records added before it was loaded are not in it
+    storage = source;
+    unsavedChanges = (initial_size > 0);
+
+    modified = storage->HasChanges() || (initial_size > 0);
+    syncedFile = filename;
+
     // Scan databse for metadata
     // Earliest and newest year of publication
     int r = 0;
@@ -64,22 +146,519 @@ bool DatabaseHandler::Load(const char *filename)
 // Write database to file
 bool DatabaseHandler::Save(const char *filename)
 {
-  DatabaseFileWriter writer;
-  bool result = writer.Save(filename, databaseName, database);
+  WaitForBackgroundSave();
+
+  // Nothing has changed since the file was read or written
+  if(!modified && (syncedFile == QString(filename))) return(true);
+
+  return(save(filename));
+}
+
+// Write the database to filename, through the storage in use if it is for that file
+bool DatabaseHandler::save(const char *filename)
+{
+  // The file being written may be the one the reviews are still in
+  FetchAllReviews();
+
+  bool current = storage && (storage->Filename() == QString(filename));
+  StorageBackend *target = current ? storage : createStorage(filename);
+
+  bool result = target->Save(databaseName, database);
+  if(!current) delete target;
+
   if(!result) qDebug() << "Handler: Failed to save database\n";
+  saveResult = result;
+
+  if(result)
+  {
+    modified = false;
+    syncedFile = filename;
+
+    // Changes the storage could not take are now in the file
+    if(current) unsavedChanges = false;
+  }
+
+  // Drop the values edited or removed records no longer use
+  strings.Prune();
 
   return(result);
 }
 
+// Make changes to the database durable
+bool DatabaseHandler::SaveChanges(const char *filename)
+{
+  WaitForBackgroundSave();
+
+  bool current = storage && (storage->Filename() == QString(filename));
+
+  // Changes are already stored; an XML journal is folded into the file once it has grown
+  if(current && !unsavedChanges && !storage->NeedsCompaction())
+    return(true);
+
+  // Store changes in a newly written file; none of the records are in it yet
+  if(!current)
+  {
+    closeStorage();
+    storage = createStorage(filename);
+    unsavedChanges = true;
+  }
+
+  return(save(filename));
+}
+
+// Start making changes durable on a worker thread
+bool DatabaseHandler::StartBackgroundSave(const char *filename)
+{
+  // Changes made meanwhile are stored and go in the next save
+  if(saveRunning) return(false);
+
+  bool current = storage && (storage->Filename() == QString(filename));
+
+  if(current && !unsavedChanges && !storage->NeedsCompaction())
+    return(false);
+  if(!modified && (syncedFile == QString(filename)))
+    return(false);
+
+  // The snapshot is taken with every review loaded
+  FetchAllReviews();
+
+  // Changes from here on are stored so that they outlive the save
+  StorageBackend *target = current ? storage : createStorage(filename);
+  if(!target->BeginBackgroundSave())
+  {
+    if(!current) delete target;
+    return(false);
+  }
+
+  if(!current)
+  {
+    closeStorage();
+    storage = target;
+  }
+
+  // The snapshot shares the records until either copy changes
+  saveSnapshot = database;
+  saveFilename = filename;
+  saveChangeCount = changeCount;
+  unsavedChanges = false;
+  saveRunning = true;
+
+  QString name = databaseName;
+
+  saveFuture = QtConcurrent::run([this, target, name]()
+  {
+    return(target->SaveSnapshot(name, saveSnapshot));
+  });
+
+  return(true);
+}
+
+// Complete the background save once it has finished
+bool DatabaseHandler::FinishBackgroundSave()
+{
+  if(!saveRunning) return(saveResult);
+
+  saveResult = saveFuture.result();
+  saveRunning = false;
+
+  if(storage && (storage->Filename() == saveFilename))
+    storage->EndBackgroundSave(saveResult);
+
+  if(saveResult)
+  {
+    syncedFile = saveFilename;
+
+    // If nothing changed meanwhile, keep the records with their new encoding, unless
+    // another thread is reading them; they are then encoded again at the next save
+    if(changeCount == saveChangeCount)
+    {
+      if(!recordsInUse) database = saveSnapshot;
+      modified = false;
+    }
+  }
+  else
+  {
+    qDebug() << "Handler: failed to save database in the background\n";
+
+    // Write the whole file at the next save
+    unsavedChanges = true;
+  }
+
+  saveSnapshot.clear();
+
+  // Once the snapshot is released, values only it used are held by the pool alone
+  strings.Prune();
+
+  return(saveResult);
+}
+
+// Wait for a background save to finish and complete it
+bool DatabaseHandler::WaitForBackgroundSave()
+{
+  if(saveRunning) saveFuture.waitForFinished();
+
+  return(FinishBackgroundSave());
+}
+
+// Add a record
+void DatabaseHandler::AddRecord(const PaperMeta &meta)
+{
+  database.push_back(meta);
+  prepareRecord(database.last());
+
+  // The first record with a citation is the one found
+  if(!citationIndex.contains(meta.citation)) citationIndex.insert(meta.citation, database.size()-1);
+  recordIndex.insert(database.last().recordId, database.size()-1);
+  changeCount++;
+
+  changeStored(storage && storage->Upsert(meta.citation, meta));
+}
+
+// Add a record in citation order
+int DatabaseHandler::InsertRecord(const PaperMeta &meta)
+{
+  // After any records with the same citation, as a stable sort would put it
+  QVector<PaperMeta>::iterator position = std::upper_bound(database.begin(), database.end(), meta);
+  int index = position-database.begin();
+
+  database.insert(index, meta);
+  prepareRecord(database[index]);
+
+  // Only the records after it have moved; each citation's first record moves once, not
+  // once for every duplicate that follows it
+  for(int r = index+1; r < database.size(); r++)
+  {
+    recordIndex[database[r].recordId] = r;
+
+    if((r-1 == index) || (database[r-1].citation != database[r].citation))
+    {
+      QHash<QString, int>::iterator first = citationIndex.find(database[r].citation);
+      if((first != citationIndex.end()) && (first.value() == r-1)) first.value() = r;
+    }
+  }
+
+  if(!citationIndex.contains(meta.citation)) citationIndex.insert(meta.citation, index);
+  recordIndex.insert(database[index].recordId, index);
+  changeCount++;
+
+  changeStored(storage && storage->Upsert(meta.citation, meta));
+
+  return(index);
+}
+
+// Give a record added to the database its ID and index its strings and tags
+void DatabaseHandler::prepareRecord(PaperMeta &meta)
+{
+  meta.xmlFragment.clear();
+  meta.recordId = nextRecordId++;
+  internRecord(meta);
+  indexTags(meta);
+  addWords(meta);
+}
+
+// Replace the record at index
+void DatabaseHandler::UpdateRecord(int index, const PaperMeta &meta)
+{
+  QString key = database[index].citation;
+  int id = database[index].recordId;
+  tagDictionary.Count(database[index].tagSet, -1);
+  removeWords(database[index]);
+  database[index] = meta;
+  database[index].xmlFragment.clear();
+  database[index].recordId = id;
+  internRecord(database[index]);
+  indexTags(database[index]);
+  addWords(database[index]);
+
+  // Another record may have the old key, or the new key after this one
+  if(key != meta.citation) indexPositions();
+  changeCount++;
+
+  changeStored(storage && storage->Upsert(key, meta));
+}
+
+// Remove the record at index
+void DatabaseHandler::RemoveRecord(int index)
+{
+  QString key = database[index].citation;
+  tagDictionary.Count(database[index].tagSet, -1);
+  removeWords(database[index]);
+  database.remove(index);
+
+  // The records after it have moved
+  indexPositions();
+  changeCount++;
+
+  changeStored(storage && storage->Remove(key));
+}
+
+// Rename the database
+void DatabaseHandler::SetName(const QString &name)
+{
+  databaseName = name;
+  changeCount++;
+
+  changeStored(storage && storage->SetName(name));
+}
+
+// Note the result of passing a change to the storage
+void DatabaseHandler::changeStored(bool stored)
+{
+  // Without storage the change is only saved by writing the whole database
+  if(!stored) unsavedChanges = true;
+
+  // A change written in place leaves the file holding the records
+  if(!stored || storage->HasChanges() || (syncedFile != storage->Filename()))
+    modified = true;
+}
+
+// Share the fields of a record that repeat across records
+void DatabaseHandler::internRecord(PaperMeta &meta)
+{
+  strings.Intern(meta.authors);
+  strings.Intern(meta.publication);
+  strings.Intern(meta.volume);
+  strings.Intern(meta.issue);
+  strings.Intern(meta.month);
+  strings.Intern(meta.year);
+  strings.Intern(meta.dates);
+  strings.Intern(meta.institution);
+  strings.Intern(meta.location);
+  strings.Intern(meta.publisher);
+  strings.Intern(meta.tags);
+}
+
+// Set the tag IDs of a record and count its tags as used
+void DatabaseHandler::indexTags(PaperMeta &meta)
+{
+  meta.tagSet = tagDictionary.Encode(meta.tags);
+  tagDictionary.Count(meta.tagSet, 1);
+}
+
+// Storage for a database file
+StorageBackend *DatabaseHandler::createStorage(const QString &filename) const
+{
+  if(SqliteStorage::IsSqlite(filename)) return(new SqliteStorage(filename));
+
+  return(new XmlStorage(filename, parallelLoad, useCache, lazyReviews, compactFormat));
+}
+
+// Stop storing changes
+void DatabaseHandler::closeStorage()
+{
+  // Reviews left in the file must be fetched before it is released
+  FetchAllReviews();
+
+  delete storage;
+  storage = nullptr;
+}
+
 // New database
 void DatabaseHandler::New(const QString &name)
 {
+  WaitForBackgroundSave();
+
   database.clear();
   databaseName = name;
+  strings.Clear();
+  tagDictionary.Clear();
+  citationIndex.clear();
+  recordIndex.clear();
+  clearWords();
+
+  // Nothing is stored until the database has been written to a file
+  delete storage;
+  storage = nullptr;
+  unsavedChanges = true;
+  modified = true;
+  syncedFile.clear();
+}
+
+// Fetch the review of a record that was loaded without it
+void DatabaseHandler::FetchReview(int index)
+{
+  PaperMeta &meta = database[index];
+  if(meta.ReviewLoaded()) return;
+
+  meta.review = ReviewText(index);
+  meta.reviewOffset = -1;
+  meta.reviewLength = 0;
+}
+
+// Fetch all reviews that are not loaded and release the database file
+void DatabaseHandler::FetchAllReviews()
+{
+  if(!storage || !storage->HoldsReviews()) return;
+
+  for(int r = 0; r < database.size(); r++) FetchReview(r);
+
+  storage->ReleaseReviews();
+}
+
+// Review text of a record, without keeping it in the record
+QString DatabaseHandler::ReviewText(int index) const
+{
+  if(!storage) return(database[index].review);
+
+  return(storage->ReviewText(database[index]));
 }
 
 // Sort database
 void DatabaseHandler::Sort()
 {
-  std::sort(database.begin(), database.end());
+  // Records are usually already in order; comparing through a const reference does not detach
+  // records shared with a background save
+  const QVector<PaperMeta> &records = database;
+  if(std::is_sorted(records.cbegin(), records.cend())) return;
+
+  // Sort an array of indices rather than the records, then move each record once
+  QVector<int> order(records.size());
+  for(int r = 0; r < order.size(); r++) order[r] = r;
+
+  std::stable_sort(order.begin(), order.end(), [&records](int a, int b)
+  {
+    return(records[a].citation < records[b].citation);
+  });
+
+  QVector<PaperMeta> sorted;
+  sorted.reserve(database.size());
+  for(int r = 0; r < order.size(); r++) sorted.push_back(std::move(database[order[r]]));
+  database.swap(sorted);
+
+  indexPositions();
+}
+
+// Index of the first record with the given citation key
+int DatabaseHandler::FindCitation(const QString &citation) const
+{
+  return(citationIndex.value(citation, -1));
+}
+
+// Index of the record with the given ID
+int DatabaseHandler::RecordIndex(int id) const
+{
+  return(recordIndex.value(id, -1));
+}
+
+// Where the memory of the database goes
+MemoryReport DatabaseHandler::MemoryUsage() const
+{
+  MemoryReport report;
+  report.records     = database.size();
+  report.recordBytes = database.capacity()*sizeof(PaperMeta);
+
+  // Buffers and values seen in any field, so sharing between fields is found too
+  QSet<const void *> buffers;
+  QSet<QString> values;
+
+  for(const auto &column : recordStringFields)
+  {
+    FieldMemory field = {column.name, 0, 0, 0, 0};
+    for(int r = 0; r < database.size(); r++) countString(field, database[r].*column.member, buffers, values);
+    report.fields.push_back(field);
+  }
+
+  for(const auto &column : reviewerStringFields)
+  {
+    FieldMemory field = {column.name, 0, 0, 0, 0};
+    for(int r = 0; r < database.size(); r++) countString(field, database[r].reviewer.*column.member, buffers, values);
+    report.fields.push_back(field);
+  }
+
+  for(int r = 0; r < database.size(); r++)
+  {
+    report.tagSetBytes  += (database[r].tagSet.size()+7)/8;
+    report.encodedBytes += database[r].xmlFragment.size();
+  }
+
+  report.citationIndexBytes = MemoryReport::HashBytes(citationIndex);
+  report.recordIndexBytes   = MemoryReport::HashBytes(recordIndex);
+  report.tagDictionaryBytes = tagDictionary.MemoryUsage();
+  report.stringPoolBytes    = strings.MemoryUsage();
+  report.pooledStrings      = strings.Size();
+  report.wordIndexBytes     = titleWords.MemoryUsage()+reviewWords.MemoryUsage();
+
+  return(report);
+}
+
+// Intern and index every record
+void DatabaseHandler::indexRecords()
+{
+  // Repeated values share one copy; tag IDs are given out again for the whole database
+  tagDictionary.Clear();
+
+  // Words are indexed again when they are next searched for
+  clearWords();
+  for(int r = 0; r < database.size(); r++)
+  {
+    internRecord(database[r]);
+    indexTags(database[r]);
+
+    // Records already in the database keep their ID
+    if(database[r].recordId == 0) database[r].recordId = nextRecordId++;
+  }
+
+  indexPositions();
+}
+
+// Index the citation key and ID of every record
+void DatabaseHandler::indexPositions()
+{
+  citationIndex.clear();
+  citationIndex.reserve(database.size());
+  recordIndex.clear();
+  recordIndex.reserve(database.size());
+
+  for(int r = 0; r < database.size(); r++)
+  {
+    if(!citationIndex.contains(database[r].citation))
+      citationIndex.insert(database[r].citation, r);
+
+    recordIndex.insert(database[r].recordId, r);
+  }
+}
+
+// Build the indexes of the words in titles and reviews
+void DatabaseHandler::IndexWords()
+{
+  if(wordsIndexed) return;
+
+  // Only read, so the records are not copied away from a background save's snapshot
+  const QVector<PaperMeta> &records = database;
+
+  // Index in order of ID so each posting list is built by appending
+  QVector<int> order(records.size());
+  for(int r = 0; r < order.size(); r++) order[r] = r;
+  std::sort(order.begin(), order.end(), [&records](int a, int b) { return(records.at(a).recordId < records.at(b).recordId); });
+
+  wordsIndexed = true;
+  for(int r = 0; r < order.size(); r++) addWords(records.at(order[r]));
+
+  qCDebug(performanceLog) << "Handler: indexed" << titleWords.Size() << "title words and" << reviewWords.Size() << "review words";
+}
+
+// Add the words of a record to the word indexes
+void DatabaseHandler::addWords(const PaperMeta &meta)
+{
+  if(!wordsIndexed) return;
+
+  titleWords.Add(meta.recordId, meta.title);
+  reviewWords.Add(meta.recordId, meta.review);
+}
+
+// Remove the words of a record from the word indexes
+void DatabaseHandler::removeWords(const PaperMeta &meta)
+{
+  if(!wordsIndexed) return;
+
+  titleWords.Remove(meta.recordId, meta.title);
+  reviewWords.Remove(meta.recordId, meta.review);
+}
+
+// Stop keeping the word indexes
+void DatabaseHandler::clearWords()
+{
+  titleWords.Clear();
+  reviewWords.Clear();
+  wordsIndexed = false;
 }
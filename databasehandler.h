@@ -10,34 +10,212 @@
 
 #include <QVector>
 #include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QFuture>
 
 #include "papermeta.h"
+#include "storagebackend.h"
+#include "stringpool.h"
+#include "tagdictionary.h"
+#include "memoryreport.h"
+#include "textindex.h"
 
 class DatabaseHandler
 {
 public:
-  DatabaseHandler() : databaseName("Default database"), startYear(-1), endYear(-1) { }
+  DatabaseHandler() : databaseName("Default database"), startYear(-1), endYear(-1), parallelLoad(true), useCache(true),
+                      lazyReviews(false), compactFormat(false), storage(nullptr), unsavedChanges(false), modified(false), changeCount(0),
+                      nextRecordId(1), wordsIndexed(false), recordsInUse(false), saveRunning(false), saveResult(true),
+                      saveChangeCount(0) { }
+
+  /// Destructor, waits for a background save and closes the storage
+  ~DatabaseHandler();
+
+  Q_DISABLE_COPY(DatabaseHandler)
 
   /**
-   * Add a database file
-   * @param filename  Name of database file
+   * Add a database file; changes are then stored in it as they are made
+   * @param filename  Name of database file, XML or SQLite
    * @return true if successfully opened
    */
   bool Load(const char *filename);
 
-  /// Write database to file
+  /**
+   * Write database to file; only records changed since the last save are encoded again
+   * and nothing is written if the file already holds the records
+   */
   bool Save(const char *filename);
 
+  /**
+   * Make changes to the database durable. Changes are already in the storage, so the file
+   * is only rewritten when the journal of an XML file has grown large, when changes could
+   * not be stored or when the database is moving to another file.
+   * @param filename  Name of the database file in use
+   */
+  bool SaveChanges(const char *filename);
+
+  /**
+   * Make changes durable as SaveChanges() does, but write the file on a worker thread from
+   * a snapshot of the records. Changes made while the file is written are stored and kept
+   * for the next save. SQLite files are not saved in the background.
+   * @return true if a save was started; FinishBackgroundSave() completes it
+   */
+  bool StartBackgroundSave(const char *filename);
+
+  /// Future of the background save
+  QFuture<bool> BackgroundSave() const { return(saveFuture); }
+
+  /// Complete the background save once it has finished, returns the result of the last save
+  bool FinishBackgroundSave();
+
+  /// Wait for a background save to finish and complete it
+  bool WaitForBackgroundSave();
+
+  /// A background save has been started and not completed
+  bool Saving() const { return(saveRunning); }
+
   /// New database
   void New(const QString &name);
 
-  /// Sort the database by citation key
+  /// Sort the database by citation key; records are only moved if they are out of order
   void Sort();
 
+  /// Number of records
+  int RecordCount() const { return(database.size()); }
+
+  /**
+   * Record at index, read in place. Indexing database itself on a non-const handler copies
+   * every record while a background save shares them, so read-only code uses this.
+   */
+  const PaperMeta &Record(int index) const { return(database.at(index)); }
+
+  /// All records, read in place
+  const QVector<PaperMeta> &Records() const { return(database); }
+
+  /// Index of the first record with the given citation key, or -1; found from a hash index
+  int FindCitation(const QString &citation) const;
+
+  /// Index of the record with the given ID, or -1 if it has been removed
+  int RecordIndex(int id) const;
+
+  /// Add a record at the end; call Sort() once a batch of records has been added
+  void AddRecord(const PaperMeta &meta);
+
+  /**
+   * Add a record in citation key order, so the database stays sorted without calling Sort()
+   * @return index of the new record
+   */
+  int InsertRecord(const PaperMeta &meta);
+
+  /// Replace the record at index, which may change its citation key
+  void UpdateRecord(int index, const PaperMeta &meta);
+
+  /// Remove the record at index
+  void RemoveRecord(int index);
+
+  /// Rename the database
+  void SetName(const QString &name);
+
+  /// Fetch the review of a record that was loaded without it
+  void FetchReview(int index);
+
+  /// Fetch all reviews that are not loaded and release the database file
+  void FetchAllReviews();
+
+  /// Review text of a record, without keeping it in the record
+  QString ReviewText(int index) const;
+
+  /**
+   * Build the indexes of the words in titles and reviews. Reviews not yet loaded must be
+   * fetched first with FetchAllReviews(), on the thread the handler belongs to. Once built
+   * the indexes are kept up to date as records change, until another database is loaded.
+   * This only reads the records, so it can run on a worker thread while they are in use.
+   */
+  void IndexWords();
+
+  /**
+   * Another thread is reading the records in place, through Records() or IndexWords(). A
+   * background save that finishes meanwhile then leaves the records where they are.
+   */
+  void SetRecordsInUse(bool in_use) { recordsInUse = in_use; }
+
+  /// Index of the words in titles, or nullptr if IndexWords() has not been called
+  const TextIndex *TitleWords() const { return(wordsIndexed ? &titleWords : nullptr); }
+
+  /// Index of the words in reviews, or nullptr if IndexWords() has not been called
+  const TextIndex *ReviewWords() const { return(wordsIndexed ? &reviewWords : nullptr); }
+
+  /// Where the memory of the database goes, for finding which fields and indexes are largest
+  MemoryReport MemoryUsage() const;
+
   QVector<PaperMeta> database;
   QString            databaseName;
   int                startYear;
   int                endYear;
+  bool               parallelLoad;    ///< Parse large files on all cores
+  bool               useCache;        ///< Keep a binary cache next to the database file
+  bool               lazyReviews;     ///< Leave review text in the file until it is needed
+  bool               compactFormat;   ///< Save in the version 2 format, which older versions cannot read
+  TagDictionary      tagDictionary;   ///< IDs of the tags used by the records
+
+private:
+  /// Write the database to filename, through the storage in use if it is for that file
+  bool save(const char *filename);
+
+  /// Storage for a database file, chosen by its extension or contents
+  StorageBackend *createStorage(const QString &filename) const;
+
+  /// Stop storing changes, fetching any reviews the storage holds first
+  void closeStorage();
+
+  /// Note the result of passing a change to the storage
+  void changeStored(bool stored);
+
+  /// Give a record added to the database its ID and index its strings and tags
+  void prepareRecord(PaperMeta &meta);
+
+  /// Share the fields of a record that repeat across records
+  void internRecord(PaperMeta &meta);
+
+  /// Set the tag IDs of a record and count its tags as used
+  void indexTags(PaperMeta &meta);
+
+  /// Intern the strings and tags of every record, give new records an ID and index them
+  void indexRecords();
+
+  /// Index the citation key and ID of every record
+  void indexPositions();
+
+  /// Add the words of a record to the word indexes, if they are built
+  void addWords(const PaperMeta &meta);
+
+  /// Remove the words of a record from the word indexes, if they are built
+  void removeWords(const PaperMeta &meta);
+
+  /// Stop keeping the word indexes
+  void clearWords();
+
+  StorageBackend    *storage;         ///< Storage changes are passed to, if any
+  bool               unsavedChanges;  ///< Changes were made that are not in the storage
+  bool               modified;        ///< Records differ from syncedFile
+  QString            syncedFile;      ///< Database file known to hold the records
+  quint64            changeCount;     ///< Number of changes made to the records
+  StringPool         strings;         ///< Values of repeated fields
+  QHash<QString, int> citationIndex;  ///< Index of the first record with each citation key
+  QHash<int, int>    recordIndex;     ///< Index of the record with each ID
+  int                nextRecordId;    ///< ID given to the next record added
+  TextIndex          titleWords;      ///< Records containing each word of a title
+  TextIndex          reviewWords;     ///< Records containing each word of a review
+  bool               wordsIndexed;    ///< The word indexes are built and kept up to date
+  bool               recordsInUse;    ///< Another thread is reading the records in place
+
+  QFuture<bool>      saveFuture;      ///< Background save
+  bool               saveRunning;     ///< saveFuture has not been completed
+  bool               saveResult;      ///< Result of the last save
+  QString            saveFilename;    ///< File written by the background save
+  QVector<PaperMeta> saveSnapshot;    ///< Records written by the background save
+  quint64            saveChangeCount; ///< changeCount when the snapshot was taken
 };
 
 #endif  // DATABASEHANDLER_H
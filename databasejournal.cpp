@@ -0,0 +1,160 @@
+/**
+ * @file   databasejournal.cpp
+ * @brief  Append-only journal of changes made since a database was last saved
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include <QFileInfo>
+#include <QXmlStreamWriter>
+#include <QDebug>
+
+#include "databasejournal.h"
+#include "databasefilereader.h"
+#include "databasefilewriter.h"
+
+// Journal filename for a database file
+QString DatabaseJournal::JournalFilename(const QString &database_filename)
+{
+  return(database_filename + DATABASE_JOURNAL_EXTENSION);
+}
+
+// Filename of the journal set aside while a save is in progress
+QString DatabaseJournal::PendingFilename(const QString &database_filename)
+{
+  return(JournalFilename(database_filename) + DATABASE_JOURNAL_PENDING_EXTENSION);
+}
+
+// Use the journal of a database file
+void DatabaseJournal::Open(const QString &database_filename)
+{
+  Close();
+  databaseFile = database_filename;
+}
+
+// Stop journaling
+void DatabaseJournal::Close()
+{
+  output.close();
+  databaseFile.clear();
+}
+
+// Read the pending changes then those in the journal
+bool DatabaseJournal::Read(QVector<DatabaseChange> *changes)
+{
+  QString filenames[] = { PendingFilename(databaseFile), JournalFilename(databaseFile) };
+
+  for(const QString &filename : filenames)
+  {
+    QFile input(filename);
+    if(!input.exists()) continue;
+
+    if(!input.open(QIODevice::ReadOnly))
+    {
+      qDebug() << "Journal: could not open " << filename << "\n";
+      return(false);
+    }
+
+    DatabaseFileReader reader;
+    if(!reader.ReadJournal(&input, changes)) return(false);
+  }
+
+  return(true);
+}
+
+// Append a change and flush it to the file
+bool DatabaseJournal::Append(const DatabaseChange &change)
+{
+  if(!output.isOpen())
+  {
+    output.setFileName(JournalFilename(databaseFile));
+    if(!output.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+      qDebug() << "Journal: could not open " << output.fileName() << " for writing\n";
+      return(false);
+    }
+  }
+
+  QXmlStreamWriter stream(&output);
+  stream.writeStartElement("change");
+
+  switch(change.type)
+  {
+    case ChangeType::Edit:   stream.writeAttribute("op", "edit");   break;
+    case ChangeType::Rename: stream.writeAttribute("op", "rename"); break;
+    case ChangeType::Delete: stream.writeAttribute("op", "delete"); break;
+    case ChangeType::Name:   stream.writeAttribute("op", "name");   break;
+  }
+
+  stream.writeAttribute("version", DATABASE_VERSION);
+
+  if(change.type == ChangeType::Name)
+    stream.writeAttribute("name", change.name);
+  else
+    stream.writeAttribute("citation", change.key);
+
+  if((change.type != ChangeType::Delete) && (change.type != ChangeType::Name))
+    DatabaseFileWriter::WriteRecord(stream, change.record);
+
+  stream.writeEndElement(); // change
+
+  // One change per line keeps the journal readable
+  output.write("\n");
+
+  return(!stream.hasError() && output.flush());
+}
+
+// Remove the journal and pending changes once they are in the database file
+void DatabaseJournal::Clear()
+{
+  output.close();
+  if(!IsOpen()) return;
+
+  ClearPending();
+
+  QString filename = JournalFilename(databaseFile);
+  if(QFile::exists(filename) && !QFile::remove(filename))
+    qDebug() << "Journal: could not remove " << filename << "\n";
+}
+
+// Set the journal aside as pending before saving
+bool DatabaseJournal::SetPending()
+{
+  output.close();
+
+  QString current = JournalFilename(databaseFile);
+  QString pending = PendingFilename(databaseFile);
+  if(!QFile::exists(current)) return(true);
+  if(!QFile::exists(pending)) return(QFile::rename(current, pending));
+
+  // Changes from a save that failed stay ahead of the newer ones
+  QFile input(current);
+  QFile append(pending);
+  if(!input.open(QIODevice::ReadOnly) || !append.open(QIODevice::WriteOnly | QIODevice::Append))
+    return(false);
+
+  QByteArray changes = input.readAll();
+  if(append.write(changes) != changes.size()) return(false);
+
+  append.close();
+  input.close();
+
+  return(QFile::remove(current));
+}
+
+// Remove the pending changes once the save has completed
+void DatabaseJournal::ClearPending()
+{
+  QString pending = PendingFilename(databaseFile);
+  if(QFile::exists(pending) && !QFile::remove(pending))
+    qDebug() << "Journal: could not remove " << pending << "\n";
+}
+
+// Size of the journal and pending changes in bytes
+qint64 DatabaseJournal::Size() const
+{
+  qint64 pending = QFileInfo(PendingFilename(databaseFile)).size();
+  if(output.isOpen()) return(pending + output.size());
+
+  return(pending + QFileInfo(JournalFilename(databaseFile)).size());
+}
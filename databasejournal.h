@@ -0,0 +1,104 @@
+/**
+ * @file   databasejournal.h
+ * @brief  Append-only journal of changes made since a database was last saved
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#ifndef DATABASEJOURNAL_H
+#define DATABASEJOURNAL_H
+
+#include <QString>
+#include <QVector>
+#include <QFile>
+
+#include "papermeta.h"
+
+/// Extension appended to the database filename for its journal
+#define DATABASE_JOURNAL_EXTENSION ".rojournal"
+
+/// Extension added to the journal while the changes in it are being saved
+#define DATABASE_JOURNAL_PENDING_EXTENSION ".pending"
+
+/// Journal size at which the changes are folded back into the database file
+#define JOURNAL_COMPACT_SIZE (1024*1024)
+
+/// Kinds of change recorded in the journal
+enum class ChangeType
+{
+  Edit,                                ///< Record added, or replaced with its key unchanged
+  Rename,                              ///< Record replaced, key changed
+  Delete,                              ///< Record removed
+  Name                                 ///< Database renamed
+};
+
+/// One change to the database
+struct DatabaseChange
+{
+  ChangeType type;
+  QString    key;                      ///< Citation of the record before the change
+  PaperMeta  record;                   ///< Record after the change, for create/edit/rename
+  QString    name;                     ///< New database name
+};
+
+/**
+ * @brief Journal of changes kept next to a database file
+ *
+ * Each change is appended to the journal as it is made, so saving costs the size of the
+ * change rather than the size of the database. Loading the database replays the journal
+ * over the records read from the file; saving the whole database empties the journal.
+ * Replaying is idempotent, so a journal left behind by an interrupted save is harmless.
+ *
+ * While the database is written in the background the journal is set aside as pending,
+ * so that changes made during the save start a new journal and are kept when the pending
+ * changes are removed.
+ */
+class DatabaseJournal
+{
+public:
+  /// Journal filename for a database file
+  static QString JournalFilename(const QString &database_filename);
+
+  /// Filename of the journal set aside while a save is in progress
+  static QString PendingFilename(const QString &database_filename);
+
+  /// Use the journal of a database file; nothing is created until a change is appended
+  void Open(const QString &database_filename);
+
+  /// Stop journaling
+  void Close();
+
+  /// Journal is in use
+  bool IsOpen() const { return(!databaseFile.isEmpty()); }
+
+  /// Database file the journal belongs to
+  QString DatabaseFilename() const { return(databaseFile); }
+
+  /**
+   * Read the pending changes then those in the journal; an incomplete change at the end, left by an
+   * interrupted write, is ignored
+   * @param changes  changes are appended here in the order they were made
+   */
+  bool Read(QVector<DatabaseChange> *changes);
+
+  /// Append a change and flush it to the file
+  bool Append(const DatabaseChange &change);
+
+  /// Remove the journal and pending changes once they are in the database file
+  void Clear();
+
+  /// Set the journal aside as pending before saving; later changes start a new journal
+  bool SetPending();
+
+  /// Remove the pending changes once the save has completed
+  void ClearPending();
+
+  /// Size of the journal and pending changes in bytes
+  qint64 Size() const;
+
+private:
+  QString databaseFile;                ///< Database file the journal belongs to
+  QFile   output;                      ///< Journal, open for appending once written to
+};
+
+#endif  // DATABASEJOURNAL_H
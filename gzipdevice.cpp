@@ -0,0 +1,182 @@
+/**
+ * @file   gzipdevice.cpp
+ * @brief  Device that streams gzip compression to or from another device
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include <cstring>
+
+#include "gzipdevice.h"
+
+/// First two bytes of a gzip stream
+#define GZIP_MAGIC_0 0x1f
+#define GZIP_MAGIC_1 0x8b
+
+/// zlib window size; adding 16 writes a gzip header, adding 32 reads gzip or zlib
+#define GZIP_WINDOW_BITS 15
+
+/// Largest block passed to zlib at once
+#define GZIP_MAX_BLOCK (1 << 30)
+
+// Constructor
+GzipDevice::GzipDevice(QIODevice *device) : device(device), streamEnd(false), failed(false)
+{
+  memset(&stream, 0, sizeof(stream));
+}
+
+// Destructor
+GzipDevice::~GzipDevice()
+{
+  close();
+}
+
+// Data at the read position of the device starts with the gzip magic number
+bool GzipDevice::IsCompressed(QIODevice *device)
+{
+  QByteArray magic = device->peek(2);
+
+  return((magic.size() == 2) && (uchar(magic[0]) == GZIP_MAGIC_0) && (uchar(magic[1]) == GZIP_MAGIC_1));
+}
+
+// Open for reading or writing
+bool GzipDevice::open(OpenMode mode)
+{
+  if(((mode & ReadWrite) == ReadWrite) || ((mode & ReadWrite) == 0))
+    return(false);
+
+  memset(&stream, 0, sizeof(stream));
+  streamEnd = false;
+  failed = false;
+  buffer.resize(GZIP_BUFFER_SIZE);
+
+  int status;
+  if(mode & ReadOnly)
+    status = inflateInit2(&stream, GZIP_WINDOW_BITS+32);
+  else
+    status = deflateInit2(&stream, GZIP_COMPRESSION_LEVEL, Z_DEFLATED, GZIP_WINDOW_BITS+16, 8, Z_DEFAULT_STRATEGY);
+
+  if(status != Z_OK)
+  {
+    setErrorString(QString("zlib initialisation failed: %1").arg(status));
+    return(false);
+  }
+
+  return(QIODevice::open(mode));
+}
+
+// Close the device
+void GzipDevice::close()
+{
+  if(!isOpen()) return;
+
+  if(openMode() & WriteOnly)
+  {
+    if(!deflateOutput(Z_FINISH)) failed = true;
+    deflateEnd(&stream);
+  }
+  else
+    inflateEnd(&stream);
+
+  QIODevice::close();
+}
+
+// Decompress data from the device
+qint64 GzipDevice::readData(char *data, qint64 max_size)
+{
+  if(failed) return(-1);
+  if(streamEnd) return(-1);
+
+  stream.next_out = reinterpret_cast<Bytef *>(data);
+  stream.avail_out = uInt(qMin<qint64>(max_size, GZIP_MAX_BLOCK));
+  uInt requested = stream.avail_out;
+
+  while(stream.avail_out > 0)
+  {
+    if(stream.avail_in == 0)
+    {
+      qint64 length = device->read(buffer.data(), buffer.size());
+      if(length <= 0) break;         // A truncated file ends early and the reader reports it
+
+      stream.next_in = reinterpret_cast<Bytef *>(buffer.data());
+      stream.avail_in = uInt(length);
+    }
+
+    int status = inflate(&stream, Z_NO_FLUSH);
+    if(status == Z_STREAM_END)
+    {
+      // Files may hold several concatenated gzip members
+      if((stream.avail_in == 0) && device->atEnd())
+      {
+        streamEnd = true;
+        break;
+      }
+      inflateReset(&stream);
+    }
+    else if((status != Z_OK) && (status != Z_BUF_ERROR))
+    {
+      setErrorString(QString("Corrupt compressed data: %1").arg(stream.msg ? stream.msg : ""));
+      failed = true;
+      return(-1);
+    }
+  }
+
+  qint64 length = requested - stream.avail_out;
+  if((length == 0) && (streamEnd || device->atEnd())) return(-1);
+
+  return(length);
+}
+
+// Compress data and write it to the device
+qint64 GzipDevice::writeData(const char *data, qint64 size)
+{
+  if(failed) return(-1);
+
+  const char *input = data;
+  qint64 remaining = size;
+  while(remaining > 0)
+  {
+    uInt block = uInt(qMin<qint64>(remaining, GZIP_MAX_BLOCK));
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input));
+    stream.avail_in = block;
+
+    if(!deflateOutput(Z_NO_FLUSH))
+    {
+      failed = true;
+      return(-1);
+    }
+
+    input += block;
+    remaining -= block;
+  }
+
+  return(size);
+}
+
+// Compress pending input and write it to the device
+bool GzipDevice::deflateOutput(int flush)
+{
+  int status;
+  do
+  {
+    stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+    stream.avail_out = uInt(buffer.size());
+
+    status = deflate(&stream, flush);
+    if(status == Z_STREAM_ERROR)
+    {
+      setErrorString("Compression failed");
+      return(false);
+    }
+
+    qint64 length = buffer.size() - stream.avail_out;
+    if((length > 0) && (device->write(buffer.constData(), length) != length))
+    {
+      setErrorString(device->errorString());
+      return(false);
+    }
+  }
+  while((stream.avail_out == 0) || ((flush == Z_FINISH) && (status != Z_STREAM_END)));
+
+  return(true);
+}
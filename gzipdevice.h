@@ -0,0 +1,73 @@
+/**
+ * @file   gzipdevice.h
+ * @brief  Device that streams gzip compression to or from another device
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#ifndef GZIPDEVICE_H
+#define GZIPDEVICE_H
+
+#include <QIODevice>
+#include <QByteArray>
+
+// The system's zlib, or the copy built into Qt where there is none; see the project file
+#include <zlib.h>
+
+/// Extension of compressed database files
+#define DATABASE_COMPRESSED_EXTENSION ".gz"
+
+/// Compression level used when writing; the markup repeats so much that a fast level
+/// compresses it nearly as well as zlib's default of 6, in much less time
+#define GZIP_COMPRESSION_LEVEL 3
+
+/// Size of the buffer of compressed data
+#define GZIP_BUFFER_SIZE (64*1024)
+
+/**
+ * @brief Sequential device that decompresses data read from, or compresses data written
+ * to, another device
+ *
+ * Data is passed through a small buffer, so neither the compressed nor the uncompressed
+ * file is held in memory. The device is opened for reading or writing, not both; closing
+ * a device open for writing completes the gzip stream.
+ */
+class GzipDevice : public QIODevice
+{
+public:
+  /// Constructor, the device must be opened separately
+  explicit GzipDevice(QIODevice *device);
+
+  /// Destructor
+  ~GzipDevice();
+
+  /// Data at the read position of the device starts with the gzip magic number
+  static bool IsCompressed(QIODevice *device);
+
+  /// Open for reading or writing
+  bool open(OpenMode mode) override;
+
+  /// Close the device, completing the compressed stream when writing
+  void close() override;
+
+  bool isSequential() const override { return(true); }
+
+  /// An error occurred in the compressed stream or the underlying device
+  bool HasError() const { return(failed); }
+
+protected:
+  qint64 readData(char *data, qint64 max_size) override;
+  qint64 writeData(const char *data, qint64 size) override;
+
+private:
+  /// Compress pending input and write it to the device
+  bool deflateOutput(int flush);
+
+  QIODevice  *device;                  ///< Device holding the compressed data
+  z_stream    stream;                  ///< zlib state
+  QByteArray  buffer;                  ///< Compressed data
+  bool        streamEnd;               ///< All data has been decompressed
+  bool        failed;                  ///< An error has occurred
+};
+
+#endif  // GZIPDEVICE_H
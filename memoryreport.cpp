@@ -0,0 +1,117 @@
+/**
+ * @file   memoryreport.cpp
+ * @brief  Account for the memory used by a loaded database
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include <QJsonArray>
+#include <QLocale>
+
+#include "memoryreport.h"
+
+// Character data held by all string fields
+qint64 MemoryReport::FieldBytes() const
+{
+  qint64 total = 0;
+  for(int f = 0; f < fields.size(); f++) total += fields[f].bytes;
+
+  return(total);
+}
+
+// Memory used by the indexes of the records
+qint64 MemoryReport::IndexBytes() const
+{
+  return(citationIndexBytes+recordIndexBytes+tagDictionaryBytes+stringPoolBytes+wordIndexBytes);
+}
+
+// Memory used by the database
+qint64 MemoryReport::TotalBytes() const
+{
+  return(recordBytes+tagSetBytes+encodedBytes+FieldBytes()+IndexBytes());
+}
+
+// Memory used per record besides its strings
+qint64 MemoryReport::RecordOverhead() const
+{
+  if(records == 0) return(0);
+
+  return((recordBytes+tagSetBytes+encodedBytes)/records);
+}
+
+// Report as JSON
+QJsonObject MemoryReport::ToJson() const
+{
+  QJsonArray field_list;
+  for(int f = 0; f < fields.size(); f++)
+  {
+    QJsonObject field;
+    field["name"]           = fields[f].name;
+    field["strings"]        = fields[f].strings;
+    field["bytes"]          = fields[f].bytes;
+    field["sharedBytes"]    = fields[f].sharedBytes;
+    field["duplicateBytes"] = fields[f].duplicateBytes;
+    field_list.append(field);
+  }
+
+  QJsonObject indexes;
+  indexes["citation"]      = citationIndexBytes;
+  indexes["recordId"]      = recordIndexBytes;
+  indexes["tagDictionary"] = tagDictionaryBytes;
+  indexes["stringPool"]    = stringPoolBytes;
+  indexes["words"]         = wordIndexBytes;
+
+  QJsonObject report;
+  report["records"]             = records;
+  report["totalBytes"]          = TotalBytes();
+  report["recordBytes"]         = recordBytes;
+  report["tagSetBytes"]         = tagSetBytes;
+  report["encodedBytes"]        = encodedBytes;
+  report["recordOverheadBytes"] = RecordOverhead();
+  report["fieldBytes"]          = FieldBytes();
+  report["fields"]              = field_list;
+  report["indexBytes"]          = IndexBytes();
+  report["indexes"]             = indexes;
+  report["pooledStrings"]       = pooledStrings;
+
+  return(report);
+}
+
+// Report as an HTML table
+QString MemoryReport::ToHtml() const
+{
+  QLocale locale;
+  auto size = [&locale](qint64 bytes) { return(locale.formattedDataSize(bytes)); };
+
+  qint64 shared = 0, duplicate = 0;
+  for(int f = 0; f < fields.size(); f++)
+  {
+    shared    += fields[f].sharedBytes;
+    duplicate += fields[f].duplicateBytes;
+  }
+
+  QString html("<table cellspacing=\"4\">");
+  html.append(QString("<tr><th align=\"left\">Total</th><td>%1</td></tr>").arg(size(TotalBytes())));
+  html.append(QString("<tr><th align=\"left\">Records</th><td>%1, %2 each besides strings</td></tr>")
+              .arg(size(recordBytes+tagSetBytes+encodedBytes), size(RecordOverhead())));
+  html.append(QString("<tr><th align=\"left\">Strings</th><td>%1, %2 saved by interning, %3 duplicated</td></tr>")
+              .arg(size(FieldBytes()), size(shared), size(duplicate)));
+  html.append(QString("<tr><th align=\"left\">Indexes</th><td>%1, %2 interned strings</td></tr>")
+              .arg(size(IndexBytes())).arg(pooledStrings));
+  html.append("</table><br>");
+
+  html.append("<table cellspacing=\"4\"><tr><th align=\"left\">Field</th><th>Values</th><th>Held</th>"
+              "<th>Shared</th><th>Duplicated</th></tr>");
+  for(int f = 0; f < fields.size(); f++)
+  {
+    if(fields[f].strings == 0) continue;
+
+    html.append(QString("<tr><td>%1</td><td align=\"right\">%2</td><td align=\"right\">%3</td>"
+                        "<td align=\"right\">%4</td><td align=\"right\">%5</td></tr>")
+                .arg(fields[f].name).arg(fields[f].strings)
+                .arg(size(fields[f].bytes), size(fields[f].sharedBytes), size(fields[f].duplicateBytes)));
+  }
+  html.append("</table>");
+
+  return(html);
+}
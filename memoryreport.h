@@ -0,0 +1,79 @@
+/**
+ * @file   memoryreport.h
+ * @brief  Account for the memory used by a loaded database
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#ifndef MEMORYREPORT_H
+#define MEMORYREPORT_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QJsonObject>
+
+/// Memory used by one string field of the records
+struct FieldMemory
+{
+  QString name;                        ///< Name of the field
+  int     strings;                     ///< Records with a value in the field
+  qint64  bytes;                       ///< Character data, counting each buffer once
+  qint64  sharedBytes;                 ///< Character data not held again as the buffer is shared
+  qint64  duplicateBytes;              ///< Part of bytes with a value already held in another buffer
+};
+
+/**
+ * @brief Where the memory of a loaded database goes
+ *
+ * Sizes are estimates from the sizes of strings and containers; the allocator's own
+ * overhead is not included. Character data is counted once for each buffer, so interned
+ * values are only counted for the first record holding them. Reviews left in the database
+ * file are not counted.
+ */
+class MemoryReport
+{
+public:
+  MemoryReport() : records(0), recordBytes(0), tagSetBytes(0), encodedBytes(0), citationIndexBytes(0),
+                   recordIndexBytes(0), tagDictionaryBytes(0), stringPoolBytes(0), wordIndexBytes(0), pooledStrings(0) { }
+
+  /// Character data held by all string fields
+  qint64 FieldBytes() const;
+
+  /// Memory used by the indexes of the records
+  qint64 IndexBytes() const;
+
+  /// Memory used by the database
+  qint64 TotalBytes() const;
+
+  /// Memory used by the record structures and their tag sets and encodings, per record
+  qint64 RecordOverhead() const;
+
+  /// Report as JSON, sizes in bytes
+  QJsonObject ToJson() const;
+
+  /// Report as an HTML table
+  QString ToHtml() const;
+
+  /// Memory used by the table of a hash, not including what its keys and values point to
+  template<class Key, class T>
+  static qint64 HashBytes(const QHash<Key, T> &hash)
+  {
+    // Each bucket holds an entry and a byte of its span's offset table
+    return(hash.capacity()*(sizeof(Key)+sizeof(T)+1));
+  }
+
+  QVector<FieldMemory> fields;         ///< String fields of the records
+  int                  records;        ///< Number of records
+  qint64               recordBytes;    ///< Record structures, including the spare capacity of the vector
+  qint64               tagSetBytes;    ///< Tag IDs of the records
+  qint64               encodedBytes;   ///< Encodings of the records kept between saves
+  qint64               citationIndexBytes;  ///< Index of citation keys
+  qint64               recordIndexBytes;    ///< Index of record IDs
+  qint64               tagDictionaryBytes;  ///< Tag dictionary, including the tags
+  qint64               stringPoolBytes;     ///< Table of interned strings
+  qint64               wordIndexBytes;      ///< Indexes of the words in titles and reviews
+  int                  pooledStrings;       ///< Distinct interned strings
+};
+
+#endif  // MEMORYREPORT_H
@@ -26,6 +26,7 @@
 #include <QFile>
 #include <QDate>
 #include <QMessageBox>
+#include <QJsonDocument>
 #include <QDebug>
 
 #include "ui_organisermain.h"
@@ -84,6 +85,11 @@ OrganiserMain::OrganiserMain(QWidget *parent) :
 
   scanThread = nullptr;
 
+  // Save status is shown at the right of the status bar
+  saveStatusLabel = new QLabel(this);
+  ui->statusBar->addPermanentWidget(saveStatusLabel);
+  connect(&saveWatcher, &QFutureWatcher<bool>::finished, this, &OrganiserMain::backgroundSaveFinished);
+
   loadSettings();
 
   connect(ui->actionImport_Reviews,  &QAction::triggered,                this, &OrganiserMain::ImportReviews);
@@ -92,7 +98,8 @@ OrganiserMain::OrganiserMain(QWidget *parent) :
   connect(ui->actionAbout,           &QAction::triggered,                this, &OrganiserMain::About);
   connect(ui->actionQuit,            &QAction::triggered,                this, &OrganiserMain::Quit);
 
-  connect(ui->actionCurrentDetails,  &QAction::triggered,                this, &OrganiserMain::showDatabaseDetails);
+  connect(ui->actionCurrentDetails,  &QAction::triggered,                this, &OrganiserMain::showCurrentDetails);
+  connect(ui->actionMemoryReport,    &QAction::triggered,                this, &OrganiserMain::ExportMemoryReport);
   connect(ui->actionName,            &QAction::triggered,                this, &OrganiserMain::DatabaseName);
   connect(ui->actionNewDatabase,     &QAction::triggered,                this, &OrganiserMain::NewDatabase);
   connect(ui->actionLoadDatabase,    &QAction::triggered,                this, &OrganiserMain::LoadDatabase);
@@ -176,7 +183,7 @@ void OrganiserMain::IngestPaper()
     RecordListItem *current = dynamic_cast<RecordListItem *>(ui->refList->currentItem());
     if(current)
     {
-      new_paper_index = current->GetRecordIndex();
+      new_paper_index = current->GetRecordId();
       paper_file = newPapers[new_paper_index];
       ask_for_paper = false;
     }
@@ -227,8 +234,7 @@ void OrganiserMain::IngestPaper()
 
     // Add to database
 
-    db.database.push_back(meta);
-    db.Sort();
+    db.InsertRecord(meta);
 
     userHistory.ReportAction(meta.citation, ROAction::Add);
     updateHistoryMenu();
@@ -246,6 +252,7 @@ void OrganiserMain::UpdateView()
   ui->deleteButton->setEnabled(false);
   ui->openPaperButton->setEnabled(false);
   ui->refList->clear();
+  listedRows.clear();
   ui->detailsViewer->clear();
   ui->paperPathLabel->clear();
 
@@ -257,8 +264,12 @@ void OrganiserMain::UpdateView()
 
     for(int r = 0; r < searchResults.size(); r++)
     {
-      RecordListItem *element = new RecordListItem(ui->refList, r);
-      element->setText(searchResults[r].citation);
+      // Results that have since been deleted are left out
+      int index = db.RecordIndex(searchResults[r]);
+      if(index < 0) continue;
+
+      RecordListItem *element = new RecordListItem(ui->refList, searchResults[r]);
+      element->setText(db.Record(index).citation);
       selected_records++;
     }
     setTagFilteringEnabled(false);
@@ -280,47 +291,37 @@ void OrganiserMain::UpdateView()
     {
       QStringList tags_of_interest = ui->tagFilterEdit->text().split(",", Qt::SkipEmptyParts);
 
-      for(int r = 0; r < db.database.size(); r++)
+      // Filter on tag IDs; a tag no record uses matches nothing
+      QBitArray filter_tags;
+      bool all_tags_known = db.tagDictionary.Lookup(tags_of_interest, &filter_tags);
+      bool filtering = !tags_of_interest.isEmpty();
+      bool reject_all = filtering && (tagFilterAnd ? !all_tags_known : (filter_tags.count(true) == 0));
+
+      for(int r = 0; r < db.RecordCount(); r++)
       {
-        // Apply tag filter
+        const PaperMeta &record = db.Record(r);
 
-        QStringList tags_of_record = db.database[r].tags.split(",", Qt::SkipEmptyParts);
-        bool filter_reject = false;
-        int matching_tags = 0;
+        // Apply tag filter
 
-        for(int t = 0; t < tags_of_interest.size(); t++)
+        if(filtering)
         {
-          if(!tags_of_record.contains(tags_of_interest[t]))
-          {
-            if(tagFilterAnd)
-            {
-              filter_reject = true;
-              break;
-            }
-          }
-          else
-          {
-            matching_tags++;
-          }
-        }
+          if(reject_all) break;
 
-        if(!tagFilterAnd)
-        {
-          if((matching_tags == 0) && (tags_of_interest.size() > 0))
-            filter_reject = true;
+          const QBitArray &tags_of_record = record.tagSet;
+          if(tagFilterAnd ? !TagDictionary::ContainsAll(tags_of_record, filter_tags)
+                          : !TagDictionary::ContainsAny(tags_of_record, filter_tags))
+            continue;
         }
 
-        if(filter_reject) continue;
-
         // Show info based on view mode
 
         switch(ui->viewCombo->currentIndex())
         {
           case 0: // reviews (entries in database)
           {
-            RecordListItem *element = new RecordListItem(ui->refList, r);
-            element->setText(db.database[r].citation);
-            element->setToolTip(db.database[r].title);
+            RecordListItem *element = new RecordListItem(ui->refList, record.recordId);
+            element->setText(record.citation);
+            element->setToolTip(record.title);
             selected_records++;
           }
           break;
@@ -329,21 +330,21 @@ void OrganiserMain::UpdateView()
           break;
 
           case 2: // reviewed papers
-          if(!db.database[r].review.isEmpty())
+          if(record.HasReview())
           {
-            RecordListItem *element = new RecordListItem(ui->refList, r);
-            element->setText(db.database[r].citation);
-            element->setToolTip(db.database[r].title);
+            RecordListItem *element = new RecordListItem(ui->refList, record.recordId);
+            element->setText(record.citation);
+            element->setToolTip(record.title);
             selected_records++;
           }
           break;
 
           case 3: // incomplete reviews
-          if(!db.database[r].reader.finished)
+          if(!record.reader.finished)
           {
-            RecordListItem *element = new RecordListItem(ui->refList, r);
-            element->setText(db.database[r].citation);
-            element->setToolTip(db.database[r].title);
+            RecordListItem *element = new RecordListItem(ui->refList, record.recordId);
+            element->setText(record.citation);
+            element->setToolTip(record.title);
             selected_records++;
           }
           break;
@@ -355,6 +356,13 @@ void OrganiserMain::UpdateView()
 
   ui->numberPapersLabel->setText(QString("%1").arg(selected_records));
 
+  // Rows of the items, to find them without searching the list
+  for(int c = 0; c < ui->refList->count(); c++)
+  {
+    QString text = ui->refList->item(c)->text();
+    if(!listedRows.contains(text)) listedRows.insert(text, c);
+  }
+
   showDatabaseDetails();
 }
 
@@ -421,8 +429,9 @@ void OrganiserMain::Settings()
 // Search dialog
 void OrganiserMain::Search()
 {
+  // Reviews are fetched and words indexed by the dialog when a search needs them
   SearchDialog *search = new SearchDialog(this);
-  search->SetRecords(db.database);
+  search->SetDatabase(&db);
   search->SetDatabaseYearRange(db.startYear, db.endYear);
   search->SetPapersRead(readPapersPath);
   int result = search->exec();
@@ -432,13 +441,12 @@ void OrganiserMain::Search()
   QStringList search_citations = search->GetResults();
   for(int c = 0; c < search_citations.size(); c++)
   {
-    for(int r = 0; r < db.database.size(); r++)
-    {
-      if(db.database[r].citation == search_citations[c])
-      {
-        searchResults.push_back(db.database[r]);
-      }
-    }
+    // Records with the same citation follow the first once sorted
+    int r = db.FindCitation(search_citations[c]);
+    if(r < 0) continue;
+
+    while((r < db.RecordCount()) && (db.Record(r).citation == search_citations[c]))
+      searchResults.push_back(db.Record(r++).recordId);
   }
 
   if(!searchResults.empty() && (result == QDialog::Accepted))
@@ -459,7 +467,7 @@ void OrganiserMain::DatabaseName()
 
   if(name_dialog->exec() == QDialog::Accepted)
   {
-    db.databaseName = name_dialog->GetName();
+    db.SetName(name_dialog->GetName());
     ui->refList->clearSelection();
     showDatabaseDetails();
   }
@@ -475,7 +483,7 @@ void OrganiserMain::setRecords(const QVector<PaperMeta> &recs)
 }
 
 // Set to current review
-void OrganiserMain::showDetailsForReview(int index)
+void OrganiserMain::showDetailsForReview(int id)
 {
   /* Old version:
    *
@@ -507,12 +515,16 @@ void OrganiserMain::showDetailsForReview(int index)
 
   /* New version: */
 
+  // Records are found by ID; new papers by their index
+  int index = id;
+  if(ui->viewCombo->currentIndex() != 1) index = db.RecordIndex(id);
   if(index < 0) return;
-  if(index >= db.database.size()) return;  // impossible
 
   bool has_details = true;
 
-  PaperMeta current_record;
+  // Records are displayed in place; only a new paper needs a record made for it
+  PaperMeta pseudo_record;
+  const PaperMeta *current_record = &pseudo_record;
 
   switch(ui->viewCombo->currentIndex())
   {
@@ -520,7 +532,10 @@ void OrganiserMain::showDetailsForReview(int index)
     // Papers
     case 2:
     case 3:
-    current_record = db.database[index];
+    // Search results
+    case 4:
+    db.FetchReview(index);
+    current_record = &db.Record(index);
     break;
 
     case 1:
@@ -528,8 +543,8 @@ void OrganiserMain::showDetailsForReview(int index)
     if(index >= newPapers.size()) return;
     // No record exists, only the paper file
     // Create a pseudo record on the fly to allow user to create a new review:
-    current_record.paperPath = newPapers[index]; // need to find path in correct new papers directory(?)
-    current_record.pseudo = true;
+    pseudo_record.paperPath = newPapers[index]; // need to find path in correct new papers directory(?)
+    pseudo_record.pseudo = true;
     has_details = true;
     break;
 
@@ -543,14 +558,6 @@ void OrganiserMain::showDetailsForReview(int index)
     break;
     */
 
-    case 4:
-    // Search results
-    // std::cerr << "There are " << searchResults.size() << " results\n";
-    if(index >= searchResults.size()) return;
-    // std::cerr << "Showing search result " << index << "\n";
-    current_record = searchResults[index];
-    break;
-
     default:
     // None of the above!
     return;
@@ -561,8 +568,8 @@ void OrganiserMain::showDetailsForReview(int index)
 
   if(has_details)
   {
-    currentReviewText = current_record.review;
-    displayFormattedDetails(current_record);
+    currentReviewText = current_record->review;
+    displayFormattedDetails(*current_record);
 
  /*
     if(current_record.pseudo)
@@ -572,9 +579,9 @@ void OrganiserMain::showDetailsForReview(int index)
 */
 
     // Only add View action to history for real reviews
-    if(!current_record.pseudo)
+    if(!current_record->pseudo)
     {
-      userHistory.ReportAction(current_record.citation, ROAction::View);
+      userHistory.ReportAction(current_record->citation, ROAction::View);
       updateHistoryMenu();
     }
 
@@ -589,7 +596,7 @@ void OrganiserMain::setDuplicates(const QStringList &duplicates)
   duplicateRefs = duplicates;
 }
 
-void OrganiserMain::showDatabaseDetails() const
+void OrganiserMain::showDatabaseDetails(bool memory) const
 {
   if(!db.databaseName.isEmpty())
   {
@@ -597,7 +604,7 @@ void OrganiserMain::showDatabaseDetails() const
     QString database_details("<html><body><p><b>Database Name:</b> ");
     database_details.append(db.databaseName).append("<br>");
     database_details.append(QString("<b>Filename:</b> %1<br><br>").arg(lastDatabaseFilename));
-    database_details.append(QString("%1 records.<br>").arg(db.database.size()));
+    database_details.append(QString("%1 records.<br>").arg(db.RecordCount()));
     database_details.append(QString("%1 new papers.<br><br>").arg(newPapers.size()));
 
     database_details.append(QString("%1 tags").arg(tags.size()));
@@ -609,18 +616,31 @@ void OrganiserMain::showDatabaseDetails() const
 
     for(int t = 0; t < tags.size(); t++) database_details.append(QString(" %1").arg(tags[t]));
 
+    // The report hashes every string, so it is only built when asked for, not on every update
+    if(memory)
+    {
+      database_details.append("<br><br><b>Memory:</b><br>");
+      database_details.append(db.MemoryUsage().ToHtml());
+    }
+
     database_details.append("</body></html>");
     ui->detailsViewer->setText(database_details);
   }
 }
 
+// Show details about current database with its memory report
+void OrganiserMain::showCurrentDetails() const
+{
+  showDatabaseDetails(true);
+}
+
 // Select a review
 void OrganiserMain::selectItem()
 {
   RecordListItem *current = dynamic_cast<RecordListItem *>(ui->refList->currentItem());
   if(current)
   {
-    showDetailsForReview(current->GetRecordIndex());
+    showDetailsForReview(current->GetRecordId());
     ui->editButton->setEnabled(true);
     ui->deleteButton->setEnabled(true);
   }
@@ -633,32 +653,24 @@ void OrganiserMain::selectItem()
 // Select the given citation
 void OrganiserMain::selectCitation(const QString &cite)
 {
-  for(int c = 0; c < ui->refList->count(); c++)
+  QListWidgetItem *item = listedItem(cite);
+  if(item)
   {
-    QListWidgetItem *item = ui->refList->item(c);
-    if(item->text() == cite)
-    {
-      ui->refList->setCurrentItem(item);
-      item->setSelected(true);
-      break;
-    }
+    ui->refList->setCurrentItem(item);
+    item->setSelected(true);
   }
 }
 
+// First item in the list with the given text, or nullptr
+QListWidgetItem *OrganiserMain::listedItem(const QString &text) const
+{
+  return(ui->refList->item(listedRows.value(text, -1)));
+}
+
 // User clicked on link in review
 void OrganiserMain::gotoLinkedReview(const QUrl &link)
 {
-  // Simple search
-  QListWidgetItem *review_item = nullptr;
-
-  for(int c = 0; c < ui->refList->count(); c++)
-  {
-    if(ui->refList->item(c)->text() == link.fileName())
-    {
-      review_item = ui->refList->item(c);
-      break;
-    }
-  }
+  QListWidgetItem *review_item = listedItem(link.fileName());
 
   if(review_item)
   {
@@ -693,6 +705,8 @@ void OrganiserMain::loadSettings()
   lastDatabaseFilename      = settings.value("last_database", "").toString();
   lastExportedHTML          = settings.value("exported_html", "").toString();
   lastEnteredReview         = QDate::fromString(settings.value("last_review_date", "Thu Jul 1 2021").toString());
+  db.lazyReviews            = settings.value("lazy_reviews", false).toBool();
+  db.compactFormat          = settings.value("compact_format", false).toBool();
   settings.endGroup();
 
   settings.beginGroup("citations");
@@ -785,6 +799,8 @@ void OrganiserMain::saveSettings()
   settings.setValue("last_database", lastDatabaseFilename);
   settings.setValue("exported_html", lastExportedHTML);
   settings.setValue("last_review_date", lastEnteredReview.toString());
+  settings.setValue("lazy_reviews", db.lazyReviews);
+  settings.setValue("compact_format", db.compactFormat);
   settings.endGroup();
 
   settings.beginGroup("citations");
@@ -831,34 +847,12 @@ void OrganiserMain::saveSettings()
 }
 
 
-// Parse database for all tags used
+// List the tags used in the database
 void OrganiserMain::buildTagList()
 {
-  tags.clear();
+  // The dictionary counts the records using each tag as they change
+  tags = db.tagDictionary.Tags();
 
-  for(int r = 0; r < db.database.size(); r++)
-  {
-    if(db.database[r].tags.isEmpty()) continue;
-
-    QStringList record_tags = db.database[r].tags.split(",", Qt::SkipEmptyParts);
-    for(int t = 0; t < record_tags.size(); t++)
-    {
-      bool present = false;
-      for(int i = 0; i < tags.size(); i++)
-      {
-        if(tags[i] == record_tags[t])
-        {
-          present = true;
-          break;
-        }
-      }
-
-      if(!present)
-        tags.push_back(record_tags[t]);
-    }
-  }
-
-  tags.sort();
   ui->tagFilterCombo->clear();
   ui->tagFilterCombo->addItems(tags);
   ui->tagFilterCombo->setEnabled(!tags.empty());
@@ -1119,27 +1113,16 @@ void OrganiserMain::displayFormattedDetails(const PaperMeta &meta_record)
 // Find paper for given index
 void OrganiserMain::findPaper(int index)
 {
-  // FIXME support newPapers mode
-
-  bool examine_search = false;  // looking at searchResults
-
-  if(ui->viewCombo->currentIndex() == 4)
-    examine_search = true;
+  bool examine_new = (ui->viewCombo->currentIndex() == 1);  // looking at newPapers
 
   if(index < 0) return;
-  if((examine_search) && (index >= searchResults.size())) return;
-  else if(index >= db.database.size()) return;
+  if(examine_new && (index >= newPapers.size())) return;
+  else if(!examine_new && (index >= db.RecordCount())) return;
 
   currentPaperPath.clear();
   ui->openPaperButton->setEnabled(false);
 
-  if(examine_search)
-  {
-    // Search result
-    if((!searchResults[index].paperPath.isEmpty()) && (QFile::exists(searchResults[index].paperPath)))
-      currentPaperPath = searchResults[index].paperPath;
-  }
-  else if(ui->viewCombo->currentIndex() == 1)
+  if(examine_new)
   {
     // New papers
     // std::cerr << "Looking for file of new paper at " << newPapers[index].toStdString() << "\n";
@@ -1148,8 +1131,8 @@ void OrganiserMain::findPaper(int index)
   }
   else
   {
-    if((!db.database[index].paperPath.isEmpty()) && (QFile::exists(db.database[index].paperPath)))
-      currentPaperPath = db.database[index].paperPath;
+    if((!db.Record(index).paperPath.isEmpty()) && (QFile::exists(db.Record(index).paperPath)))
+      currentPaperPath = db.Record(index).paperPath;
   }
 
   if(!currentPaperPath.isEmpty())
@@ -1337,7 +1320,7 @@ void OrganiserMain::showStatus()
 
   // Get statistics
 
-  int total_reviews          = db.database.size();
+  int total_reviews          = db.RecordCount();
   int completed_reviews      = 0;
   int papers_to_read         = newPapers.size();
   int papers_with_reviews    = 0;
@@ -1349,12 +1332,12 @@ void OrganiserMain::showStatus()
   int reviewed_this_month = 0;
   int reviewed_last_quarter = 0;  // TODO this is not used for quarters
 
-  for(int r = 0; r < db.database.size(); r++)
+  for(int r = 0; r < db.RecordCount(); r++)
   {
-    PaperMeta record = db.database[r];
+    const PaperMeta &record = db.Record(r);
     if(record.reader.finished) completed_reviews++;
 
-    if(record.review.isEmpty())
+    if(!record.HasReview())
       papers_without_reviews++;
     else
       papers_with_reviews++;
@@ -1426,15 +1409,15 @@ void OrganiserMain::showStatus()
   {
     formatted_text.append("<hr><b>Warning! Duplicate References Detected</b><br>");
 
-    for(int r = 1; r < db.database.size(); r++) // TODO should this be r+=2 ?
+    for(int r = 1; r < db.RecordCount(); r++) // TODO should this be r+=2 ?
     {
-      if(db.database[r].citation == db.database[r-1].citation)
+      if(db.Record(r).citation == db.Record(r-1).citation)
       {
-        formatted_text.append(QString("<p>Reference %1<br>").arg(db.database[r].citation));
+        formatted_text.append(QString("<p>Reference %1<br>").arg(db.Record(r).citation));
 
-        if(db.database[r-1].paperPath != db.database[r].paperPath)
+        if(db.Record(r-1).paperPath != db.Record(r).paperPath)
         {
-          formatted_text.append(QString("has papers at<br>%1 <b>and</b> %2<br>").arg(db.database[r-1].paperPath, db.database[r].paperPath));
+          formatted_text.append(QString("has papers at<br>%1 <b>and</b> %2<br>").arg(db.Record(r-1).paperPath, db.Record(r).paperPath));
         }
 
         formatted_text.append("</p>");
@@ -1500,6 +1483,7 @@ void OrganiserMain::rescanPaths()
   // clear all
   ui->openPaperButton->setEnabled(false);
   ui->refList->clear();
+  listedRows.clear();
 
   ScanPaperPaths();
 }
@@ -1590,14 +1574,12 @@ void OrganiserMain::editReview()
   else
   {
     // Search database for citation
-    for(int r = 0; r < db.database.size(); r++)
+    int r = db.FindCitation(cite);
+    if(r >= 0)
     {
-      if(db.database[r].citation == cite)
-      {
-        meta = db.database[r];
-        found = true;
-        break;
-      }
+      db.FetchReview(r);
+      meta = db.database[r];
+      found = true;
     }
   }
 
@@ -1739,57 +1721,27 @@ void OrganiserMain::modifyOrNew(PaperMeta &meta)
   else
     cite_searchterm = meta.citation;
 
-  for(int r = 0; r < db.database.size(); r++)
+  int record_index = meta.citation.isEmpty() ? -1 : db.FindCitation(cite_searchterm);
+  if(record_index >= 0)
   {
-    if((db.database[r].citation == cite_searchterm) && (!meta.citation.isEmpty()))
-    {
-      // In database -> update the record
-      in_database = true;
-      db.database[r]  = meta;
-      break;
-    }
-  }
-
-  if(ui->viewCombo->currentIndex() == 4)
-  {
-    // Just edited a search result
-    for(int r = 0; r < searchResults.size(); r++)
-    {
-      if(searchResults[r].citation == cite_searchterm)
-      {
-        searchResults[r] = meta;
-        break;
-      }
-    }
+    // In database -> update the record
+    in_database = true;
+    db.UpdateRecord(record_index, meta);
   }
 
   if(!in_database)
   {
     // Not in database -> add to database
-    db.database.push_back(meta);
+    db.InsertRecord(meta);
 
     QDate current_date = QDate::currentDate();
     if(current_date > lastEnteredReview)
         lastEnteredReview = current_date;
   }
-
-  db.Sort();
+  else
+    db.Sort();  // A changed citation may have moved the record
   if(tags_added) buildTagList();
 
-  // Update search results if record was searched
-  if(!searchResults.empty() && ui->viewCombo->currentIndex() == 4)
-  {
-    for(int r = 0; r < searchResults.size(); r++)
-    {
-      if((searchResults[r].citation == cite_searchterm) && (!meta.citation.isEmpty()))
-      {
-        // In results -> update the record
-        searchResults[r]  = meta;
-        break;
-      }
-    }
-  }
-
   HistoryItem hi;
   hi.text   = meta.citation;
   if(!in_database)
@@ -1801,15 +1753,8 @@ void OrganiserMain::modifyOrNew(PaperMeta &meta)
 
   UpdateView();
 
-  for(int r = 0; r < ui->refList->count(); r++)
-  {
-    QListWidgetItem *row_r = ui->refList->item(r);
-    if(row_r->text() == meta.citation)
-    {
-      ui->refList->setCurrentItem(row_r);
-      break;
-    }
-  }
+  QListWidgetItem *item = listedItem(meta.citation);
+  if(item) ui->refList->setCurrentItem(item);
 }
 
 // Move the paper to the read papers dir, as part of ingestion process
@@ -1866,22 +1811,13 @@ void OrganiserMain::deleteReview()
 
   if(ret == QMessageBox::Ok)
   {
-    int item_to_remove = ui->refList->currentRow();
-
-    if(ui->viewCombo->currentIndex() != 0)
-    {
-      // Current view is not unfiltered database
-      for(int r = 0; r < db.database.size(); r++)
-      {
-        if(db.database[r].citation == selected_citation)
-        {
-          item_to_remove = r;
-          break;
-        }
-      }
-    }
+    // New papers are not in the database
+    RecordListItem *current = dynamic_cast<RecordListItem *>(ui->refList->currentItem());
+    int item_to_remove = -1;
+    if(current && (ui->viewCombo->currentIndex() != 1))
+      item_to_remove = db.RecordIndex(current->GetRecordId());
 
-    db.database.remove(item_to_remove);
+    if(item_to_remove >= 0) db.RemoveRecord(item_to_remove);
 
     clearDetails();
 
@@ -1914,6 +1850,22 @@ void OrganiserMain::clearDetails()
   ui->paperPathLabel->clear();
 }
 
+// Save a report of the memory used by the database
+void OrganiserMain::ExportMemoryReport()
+{
+  QString outfile = QFileDialog::getSaveFileName(this, tr("Save memory report to..."), QDir::homePath(), tr("JSON (*.json)"));
+  if(outfile.isEmpty()) return;
+
+  QFile output(outfile);
+  if(!output.open(QIODevice::WriteOnly) ||
+     (output.write(QJsonDocument(db.MemoryUsage().ToJson()).toJson()) < 0))
+  {
+    QMessageBox::warning(this, tr("Reference Organiser"),
+                         tr("Could not save the memory report.\n"),
+                         QMessageBox::Cancel);
+  }
+}
+
 // Import review files
 void OrganiserMain::ImportReviews()
 {
@@ -1963,7 +1915,7 @@ void OrganiserMain::ImportReviews()
 
       QFileInfo finfo(source_files[f]);
       meta.reviewDate = finfo.lastModified().date();
-      db.database.push_back(meta);
+      db.AddRecord(meta);
     }
   }
 
@@ -2004,15 +1956,15 @@ void OrganiserMain::ExportHTML()
   op << " </head>\n <body>\n";
 
   // Iterate through each reference with a review
-  for(int r = 0; r < db.database.size(); r++)
+  for(int r = 0; r < db.RecordCount(); r++)
   {
     QString review;
     QString authors, title, year;
 
-    review  = db.database[r].review;
-    authors = db.database[r].authors;
-    title   = db.database[r].title;
-    year    = db.database[r].year;
+    review  = db.ReviewText(r);
+    authors = db.Record(r).authors;
+    title   = db.Record(r).title;
+    year    = db.Record(r).year;
 
     review = review.trimmed();  // remove extra whitespace at start and end of string
 
@@ -2036,9 +1988,9 @@ void OrganiserMain::ExportHTML()
     if(!review.isEmpty())
       op << "  <div class=\"review\">\n  <pre>\n" << review.toUtf8().constData() << "</pre>\n  </div>\n";
 
-    op << "  <div class=\"citation\">" << db.database[r].citation.toUtf8().constData() << "</div>\n";
-    if(!db.database[r].paperPath.isEmpty())
-      op << "  <a href=\"file://" << db.database[r].paperPath.toUtf8().constData() << "\">paper</a>";
+    op << "  <div class=\"citation\">" << db.Record(r).citation.toUtf8().constData() << "</div>\n";
+    if(!db.Record(r).paperPath.isEmpty())
+      op << "  <a href=\"file://" << db.Record(r).paperPath.toUtf8().constData() << "\">paper</a>";
     op << " </div>\n";
   }
 
@@ -2062,7 +2014,7 @@ bool OrganiserMain::SaveDatabaseAs()
   // Get filename to save to
   QString filename = QFileDialog::getSaveFileName(this, tr("Database filename"),
                                                         QString("%1/papers.rodb").arg(documents_path),
-                                                        tr("Database files (*.rodb *.xml)"));
+                                                        tr("Database files (*.rodb *.rodb.gz *.rosqlite *.xml)"));
   if(filename.isEmpty())
     return(false);
 
@@ -2132,7 +2084,7 @@ void OrganiserMain::LoadDatabase()
   // Get filename to load
   QString filename = QFileDialog::getOpenFileName(this, tr("Load Database"),
                                                           documents_path,
-                                                          tr("Database files (*.rodb *.xml)"));
+                                                          tr("Database files (*.rodb *.rodb.gz *.rosqlite *.xml)"));
   if(filename.isEmpty())
     return;
 
@@ -2142,6 +2094,7 @@ void OrganiserMain::LoadDatabase()
   ui->deleteButton->setEnabled(false);
   ui->openPaperButton->setEnabled(false);
   ui->refList->clear();
+  listedRows.clear();
   ui->detailsViewer->clear();
   ui->paperPathLabel->clear();
   db.database.clear();
@@ -2225,18 +2178,38 @@ void OrganiserMain::startup()
   timer->start(5*60*1000);
 }
 
-// Save current database
+// Save current database; changes are already stored so this only rewrites the file when needed
 bool OrganiserMain::saveDatabase()
 {
-  return(db.Save(lastDatabaseFilename.toUtf8().constData()));
+  bool result = db.SaveChanges(lastDatabaseFilename.toUtf8().constData());
+  saveStatusLabel->setText(result ? QString() : tr("Save failed"));
+
+  return(result);
 }
 
-// Save database periodically
+// Save database periodically, in the background
 void OrganiserMain::periodicSave()
 {
-  if(!lastDatabaseFilename.isEmpty())
-    if(!saveDatabase())
-      qDebug() << "Failed to save database periodically";
+  if(lastDatabaseFilename.isEmpty()) return;
+
+  // The file is written on a worker thread while editing carries on
+  if(db.StartBackgroundSave(lastDatabaseFilename.toUtf8().constData()))
+  {
+    saveStatusLabel->setText(tr("Saving..."));
+    saveWatcher.setFuture(db.BackgroundSave());
+  }
+}
+
+// A background save has finished
+void OrganiserMain::backgroundSaveFinished()
+{
+  if(db.FinishBackgroundSave())
+    saveStatusLabel->clear();
+  else
+  {
+    qDebug() << "Failed to save database periodically";
+    saveStatusLabel->setText(tr("Save failed"));
+  }
 }
 
 // Generate a citation key for the given authors and year
@@ -2328,16 +2301,21 @@ void OrganiserMain::searchDuplicates(const QString &authors, const QString &titl
   QString title_noaccents = RemoveAccents(title).toLower();
   QString authors_noaccents = RemoveAccents(authors).toLower();
 
+  // Split the new paper's fields once rather than for each record
+  QStringList title_words = title.split(u' ', Qt::SkipEmptyParts);
+  QStringList new_author_list = authors_noaccents.split(',', Qt::SkipEmptyParts);
+  int iyear = year.toInt();
+
   QVector<PaperMeta> potential_matches;
 
   // Check database for similar paper
-  for(int i = 0; i < db.database.size(); i++)
+  for(int i = 0; i < db.RecordCount(); i++)
   {
     bool match = false;        // paper is a match
     bool title_match = false;  // title is a weak match
 
-    PaperMeta record = db.database[i];
-    if(record.title.toLower() == title.toLower())
+    const PaperMeta &record = db.Record(i);
+    if(record.title.compare(title, Qt::CaseInsensitive) == 0)
     {
       match = true;  // exact match to title
     }
@@ -2350,33 +2328,31 @@ void OrganiserMain::searchDuplicates(const QString &authors, const QString &titl
         // Compare titles for matching words
 
         QStringList list1 = record.title.split(u' ', Qt::SkipEmptyParts);
-        QStringList list2 = title.split(u' ', Qt::SkipEmptyParts);
 
         int matched_words = 0;
         for(int w = 0; w < list1.size(); w++) {
-          if(list2.contains(list1[w], Qt::CaseInsensitive)) matched_words++;
+          if(title_words.contains(list1[w], Qt::CaseInsensitive)) matched_words++;
         }
         if(matched_words >= 0.75*list1.size()) title_match = true;
       }
     }
 
     bool year_match = false;
-    int iyear = year.toInt();
     if(abs(iyear - record.year.toInt()) <= 1)  // review of preprint may have happened a year before reviewing published paper
       year_match = true;  // weak year match
 
     bool authors_match = false;
-    if(record.authors.toLower() == authors.toLower())
+    if(record.authors.compare(authors, Qt::CaseInsensitive) == 0)
       authors_match = true;  // exact authors match
     else
     {
       // Weak authors match
-      if(RemoveAccents(record.authors).toLower() == authors_noaccents)
+      QString record_authors_noaccents = RemoveAccents(record.authors).toLower();
+      if(record_authors_noaccents == authors_noaccents)
         authors_match = true;
 
       // Try to reduce authors names
-      QStringList new_author_list = authors_noaccents.split(',', Qt::SkipEmptyParts);
-      QStringList other_author_list = RemoveAccents(record.authors).toLower().split(',', Qt::SkipEmptyParts);
+      QStringList other_author_list = record_authors_noaccents.split(',', Qt::SkipEmptyParts);
       if(new_author_list.size() == other_author_list.size())
       {
         int iname = 0;
@@ -2421,15 +2397,7 @@ void OrganiserMain::searchDuplicates(const QString &authors, const QString &titl
 // Checks if citation is in use
 bool OrganiserMain::checkCitationExists(const QString &text)
 {
-  for(int i = 0; i < db.database.size(); i++)
-  {
-    if(db.database[i].citation == text)
-    {
-      return(true);
-    }
-  }
-
-  return(false);
+  return(db.FindCitation(text) >= 0);
 }
 
 // Utility function: abbreviates string
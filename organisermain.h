@@ -11,9 +11,12 @@
 #include <QMainWindow>
 #include <QStringList>
 #include <QListWidgetItem>
+#include <QHash>
 #include <QVector>
 #include <QRegularExpression>
 #include <QThread>
+#include <QFutureWatcher>
+#include <QLabel>
 
 #include "databasehandler.h"
 #include "papermeta.h"
@@ -80,6 +83,9 @@ public slots:
   /// Export the reviews as a single page HTML file
   void ExportHTML();
 
+  /// Save a report of the memory used by the database as JSON
+  void ExportMemoryReport();
+
   /// Save the paper database as XML
   bool SaveDatabaseAs();
 
@@ -112,14 +118,20 @@ private slots:
   /// Citations in database that are repeated
   void setDuplicates(const QStringList &duplicates);
 
-  /// Show details about current database
-  void showDatabaseDetails() const;
+  /**
+   * Show details about current database
+   * @param memory  Include the memory report, which reads every string of the records
+   */
+  void showDatabaseDetails(bool memory = false) const;
+
+  /// Show details about current database with its memory report
+  void showCurrentDetails() const;
 
   /**
    * Set to current review
-   * @param index   index into current view, either database or search results
+   * @param id   ID of the record, or index of the paper in the new papers view
    */
-  void showDetailsForReview(int index);
+  void showDetailsForReview(int id);
 
   /// Display formatted text for review
   void displayFormattedDetails(const PaperMeta &meta_record);
@@ -202,9 +214,12 @@ private slots:
   /// Save current database - always tries to save
   bool saveDatabase();
 
-  /// Save database periodically
+  /// Save database periodically, in the background
   void periodicSave();
 
+  /// A background save has finished
+  void backgroundSaveFinished();
+
 private:
   /// Load saved settings
   void loadSettings();
@@ -212,10 +227,10 @@ private:
   /// Save settings
   void saveSettings();
 
-  /// Parse database for all tags used; clears any current list
+  /// List the tags used in the database; clears any current list
   void buildTagList();
 
-  /// Find paper for given index
+  /// Find paper for given index into the database, or into the new papers in that view
   void findPaper(int index);
 
   /// Get bibtext for record
@@ -227,6 +242,9 @@ private:
   /// Checks if citation is in use
   bool checkCitationExists(const QString &text);
 
+  /// First item in the list with the given text, or nullptr
+  QListWidgetItem *listedItem(const QString &text) const;
+
   /// Utility function: abbreviates string
   static QString shortenString(const QString &src, int max_length = 50);
 
@@ -239,13 +257,14 @@ private:
   QString     readPapersPath;            ///< Where read papers should be ingested to
 
   QVector<PaperMeta> records;            ///< List of all records
-  QVector<PaperMeta> searchResults;      ///< List of records obtained from searching
+  QVector<int> searchResults;            ///< IDs of records obtained from searching
   QThread       *scanThread;
   ReviewScanner *scanner;
 
   QStringList duplicateRefs;             ///< List of references that have duplicates
 
   QStringList tags;                      ///< Tags used in database
+  QHash<QString, int> listedRows;        ///< Row of the first item in the list with each text
   QString currentPaperPath;              ///< Full path, including extension
   QString currentReviewText;             ///< Including headers
 
@@ -274,6 +293,8 @@ private:
   QDate   lastEnteredReview;             ///< When last review was added
   QString lastPaperPath;                 ///< Path to last paper
   DatabaseHandler db;                    ///< Handles loading and saving of the current database
+  QFutureWatcher<bool> saveWatcher;      ///< Watches background saves of the database
+  QLabel *saveStatusLabel;               ///< Shows a save in progress or failed
 
   QString prefReviewEditFontName;        ///< Family of font used for editing reviews
   int     prefReviewEditFontSize;        ///< Size of font used for editing reviews
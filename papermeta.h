@@ -9,6 +9,8 @@
 #define PAPERMETA_H
 
 #include <QString>
+#include <QByteArray>
+#include <QBitArray>
 #include <QDate>
 
 /// Type of place where a paper was published
@@ -120,6 +122,11 @@ public:
     pseudo               = false;
     ingest               = false;
 
+    reviewOffset         = -1;
+    reviewLength         = 0;
+
+    recordId             = 0;
+
     reader.finished      = false;
     reader.understanding = 1;
     reader.rating        = 1;
@@ -157,6 +164,14 @@ public:
 
   QString     originalCitation;  ///< If the citation is changed; this stores the original citation
 
+  qint64      reviewOffset;  ///< Byte offset of the review in the database file if it was not loaded, otherwise -1
+  qint64      reviewLength;  ///< Length in bytes of the review that was not loaded
+
+  QByteArray  xmlFragment;   ///< Record encoded for the database file, kept between saves; empty if changed
+
+  QBitArray   tagSet;        ///< IDs of the tags in the database's tag dictionary, set by the database handler
+  int         recordId;      ///< Identifies the record while the database is open, 0 if it is not in the database
+
   ReaderMeta    reader;    ///< For readers to rank papers
   ReviewerMeta  reviewer;  ///< For paper reviewers
 
@@ -175,6 +190,13 @@ public:
     pseudo = false;
     ingest = false;
 
+    reviewOffset = -1;
+    reviewLength = 0;
+
+    xmlFragment.clear();
+    tagSet.clear();
+    recordId = 0;
+
     reader.finished      = false;
     reader.understanding = 1;
     reader.rating        = 1;
@@ -191,6 +213,18 @@ public:
   }
 
 
+  /// Review text is loaded, or there is no review
+  bool ReviewLoaded() const
+  {
+    return(reviewOffset < 0);
+  }
+
+  /// Record has a review, whether or not it has been loaded
+  bool HasReview() const
+  {
+    return(!review.isEmpty() || (reviewLength > 0));
+  }
+
   /// Comparison for sorting
   bool operator<(const PaperMeta &rhs) const
   {
@@ -223,4 +257,9 @@ public:
   }
 };
 
+// Every member can be moved in memory, so records are shifted without copying their strings
+Q_DECLARE_TYPEINFO(ReaderMeta, Q_RELOCATABLE_TYPE);
+Q_DECLARE_TYPEINFO(ReviewerMeta, Q_RELOCATABLE_TYPE);
+Q_DECLARE_TYPEINFO(PaperMeta, Q_RELOCATABLE_TYPE);
+
 #endif  // PAPERMETA_H
@@ -0,0 +1,11 @@
+/**
+ * @file   performancelog.cpp
+ * @brief  Logging category for timings of loads and searches
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include "performancelog.h"
+
+// Debug messages are only shown when enabled by a logging rule
+Q_LOGGING_CATEGORY(performanceLog, "reforg.performance", QtInfoMsg)
@@ -0,0 +1,19 @@
+/**
+ * @file   performancelog.h
+ * @brief  Logging category for timings of loads and searches
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#ifndef PERFORMANCELOG_H
+#define PERFORMANCELOG_H
+
+#include <QLoggingCategory>
+
+/**
+ * Timings and sizes of loads, searches and indexes, for comparing strategies on large
+ * databases. Off by default; enable with QT_LOGGING_RULES="reforg.performance.debug=true".
+ */
+Q_DECLARE_LOGGING_CATEGORY(performanceLog)
+
+#endif  // PERFORMANCELOG_H
@@ -13,14 +13,15 @@
 class RecordListItem : public QListWidgetItem
 {
 public:
-  RecordListItem(QListWidget *parent, int index) : QListWidgetItem(parent, QListWidgetItem::Type), recordIndex(index)
+  RecordListItem(QListWidget *parent, int id) : QListWidgetItem(parent, QListWidgetItem::Type), recordId(id)
   {
   }
 
-  int GetRecordIndex() const { return(recordIndex); }
+  /// ID of the record, which stays valid when the database is sorted; in the new papers view, the index of the paper
+  int GetRecordId() const { return(recordId); }
 
 private:
-  int recordIndex;
+  int recordId;
 };
 
 #endif  // RECORDLISTITEM_H
@@ -6,14 +6,21 @@
  */
 
 #include <iostream>
+#include <algorithm>
 
 #include <QFileDialog>
 #include <QRegularExpression>
 #include <QSettings>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <QtConcurrent>
+#include <QDebug>
 
 #include "searchdialog.h"
 #include "ui_searchdialog.h"
 #include "reviewparser.h"
+#include "performancelog.h"
 
 // Constructor
 Searcher::Searcher() : QObject()
@@ -24,8 +31,35 @@ Searcher::Searcher() : QObject()
   kwTitle   = false;
   kwReview  = false;
 
-  records   = nullptr;
-  doRun     = false;
+  records     = nullptr;
+  titleWords  = nullptr;
+  reviewWords = nullptr;
+  halted      = QSharedPointer<std::atomic<bool>>::create(false);
+}
+
+// Add the IDs of records containing all the words to ids
+static void findWords(const TextIndex *index, const QStringList &words, QSet<int> *ids)
+{
+  // Start from the rarest word and check the others only for its records
+  QVector<const QVector<int> *> lists;
+  for(int w = 0; w < words.size(); w++)
+  {
+    const QVector<int> *postings = index->Postings(words[w]);
+    if(!postings) return;
+    lists.push_back(postings);
+  }
+  if(lists.isEmpty()) return;
+
+  std::sort(lists.begin(), lists.end(), [](const QVector<int> *a, const QVector<int> *b) { return(a->size() < b->size()); });
+
+  for(int id : *lists[0])
+  {
+    bool all = true;
+    for(int l = 1; all && (l < lists.size()); l++)
+      all = std::binary_search(lists[l]->begin(), lists[l]->end(), id);
+
+    if(all) ids->insert(id);
+  }
 }
 
 // Begin search
@@ -37,180 +71,314 @@ void Searcher::process()
     return;
   }
 
-  doRun = true;
+  // The first search of the text indexes its words, here rather than on the GUI thread
+  if(indexBuilder) indexBuilder(&titleWords, &reviewWords);
+
+  QElapsedTimer search_timer;
+  search_timer.start();
+
+  compile();
+  qint64 compile_time = search_timer.nsecsElapsed();
+
+  // Divide the records between the cores; each chunk's matches are in citation order and
+  // the chunks are reported in order, so results arrive as from a single scan
+  int count = records->size();
+  int chunks = qBound(1, count/SEARCH_MIN_CHUNK_SIZE, QThread::idealThreadCount()*SEARCH_CHUNKS_PER_THREAD);
+
+  QVector<QPair<int, int>> ranges;
+  for(int c = 0; c < chunks; c++)
+    ranges.push_back(qMakePair(int(qint64(count)*c/chunks), int(qint64(count)*(c+1)/chunks)));
+
+  QFuture<QVector<int>> scan = QtConcurrent::mapped(ranges, [this](const QPair<int, int> &range)
+  {
+    return(scanRange(range.first, range.second));
+  });
+
+  // Results are sent in batches so a broad search does not flood the dialog with events
+  int results = 0;
+  QVector<int> batch;
+  QElapsedTimer batch_timer;
+  batch_timer.start();
+
+  for(int c = 0; (c < ranges.size()) && !*halted; c++)
+  {
+    const QVector<int> matches = scan.resultAt(c);
+    batch += matches;
+    results += matches.size();
 
+    if((batch.size() >= SEARCH_RESULT_BATCH_SIZE) || (batch_timer.elapsed() >= SEARCH_RESULT_BATCH_INTERVAL))
+    {
+      if(!batch.isEmpty()) emit result(batch);
+      batch.clear();
+      batch_timer.restart();
+    }
+  }
+
+  if(!batch.isEmpty()) emit result(batch);
+
+  // The chunks read the plan, so they must all have stopped
+  scan.waitForFinished();
+
+  // Compile and search times, to compare search strategies on large databases
+  qCDebug(performanceLog) << "Searcher: compiled" << plan.size() << "tests in" << compile_time/1000 << "us, searched"
+           << records->size() << "records in" << search_timer.elapsed() << "ms," << results << "results";
+
+  emit finished();
+}
+
+// Indexes of the records from first up to last that match, stopping early if halted
+QVector<int> Searcher::scanRange(int first, int last) const
+{
+  QVector<int> matches;
+
+  for(int r = first; (r < last) && !*halted; r++)
+  {
+    if(test(records->at(r))) matches.push_back(r);
+  }
+
+  return(matches);
+}
+
+// Record passes every test of the compiled search
+bool Searcher::test(const PaperMeta &record) const
+{
+  for(int s = 0; s < plan.size(); s++)
+  {
+    if(!plan[s].test(record)) return(false);
+  }
+
+  return(true);
+}
+
+// Build the tests of the search once, before any record is checked
+void Searcher::compile()
+{
+  plan.clear();
+
+  // Direct match on paper path is enough
+  if(!paperFile.isEmpty())
+  {
+    QString path = paperFile;
+    plan.push_back({CostPath, [path](const PaperMeta &r) { return(r.paperPath == path); }});
+    return;
+  }
+
+  // Check year
+  if(yearStart != -1)
+  {
+    int start = yearStart;
+    int stop  = yearStop;
+    plan.push_back({CostYear, [start, stop](const PaperMeta &r)
+    {
+      int year = r.year.toInt();
+      return((year >= start) && (year <= stop));
+    }});
+  }
+
+  // Match if keyword is in title or review
+  if(kwTitle || kwReview)
+    compileKeywords();
+
+  // Match the query, its indexed terms first
+  if(!queryText.isEmpty())
+    compileQuery();
+
+  // Check match by author: only need one author to be a match
+  if(!searchAuthors.isEmpty())
+  {
+    // separate authors into QStringList of individual authors
+    QStringList author_list = searchAuthors.toLower().split(',', Qt::SkipEmptyParts);
+
+    QRegularExpression search_regexp(wordsExpression(author_list),
+                                     QRegularExpression::CaseInsensitiveOption |
+                                     QRegularExpression::UseUnicodePropertiesOption);
+    search_regexp.optimize();
+
+    plan.push_back({CostAuthors, [search_regexp](const PaperMeta &r) { return(r.authors.contains(search_regexp)); }});
+  }
+
+  // Cheap tests rule most records out before the expensive ones are run
+  std::stable_sort(plan.begin(), plan.end(), [](const SearchStep &a, const SearchStep &b) { return(a.cost < b.cost); });
+}
+
+// Add the tests for the keywords to the plan
+void Searcher::compileKeywords()
+{
   // Make list of keywords to search for
 
   QStringList keywords_list;
 
   // convert commas to spaces
-  keywords = keywords.replace(QRegularExpression(","), " ");
+  QString words = keywords;
+  words.replace(u',', u' ');
 
   int pos = 0;
   while(true)
   {
-    int quote_start = keywords.indexOf("\"", pos);
+    int quote_start = words.indexOf("\"", pos);
     if(quote_start < 0) break;
 
     pos = quote_start+1;
-    int quote_end = keywords.indexOf("\"", pos);
+    int quote_end = words.indexOf("\"", pos);
     if(quote_end < 0)
     {
       // Mismatched quotes
       break;
     }
 
-    QString quoted_string = keywords.mid(quote_start+1, quote_end-(quote_start+1));
+    QString quoted_string = words.mid(quote_start+1, quote_end-(quote_start+1));
 
-    keywords.remove(quote_start, quote_end-quote_start+1);
+    words.remove(quote_start, quote_end-quote_start+1);
     keywords_list << quoted_string;
   }
 
-  QStringList keywords_split = keywords.split(' ', Qt::SkipEmptyParts);
+  QStringList keywords_split = words.split(' ', Qt::SkipEmptyParts);
   keywords_list = keywords_list+keywords_split;
 
-  // Basic: iterate through all records looking for matches
+  // One expression matches any of the keywords, compiled before the search starts
+  QRegularExpression search_regexp(wordsExpression(keywords_list),
+                                   QRegularExpression::CaseInsensitiveOption |
+                                   QRegularExpression::UseUnicodePropertiesOption);
+  search_regexp.optimize();
 
-  QVector<PaperMeta>::const_iterator it = records->begin();
-
-  while(it != records->end())
+  bool title  = kwTitle;
+  bool review = kwReview;
+  SearchStep text_match = {review ? CostReview : CostTitle, [search_regexp, title, review](const PaperMeta &r)
   {
-    if(!doRun)
-      break;
+    return((title && r.title.contains(search_regexp)) || (review && r.review.contains(search_regexp)));
+  }};
 
-    // Direct match on paper path is enough
-    if(!paperFile.isEmpty())
-    {
-      if(it->paperPath == paperFile)
-      {
-        emit result(it->citation, it->title);
-      }
-      ++it;
-      continue;
-    }  
+  // Keywords that are all words are looked up in the word indexes, so the text of most
+  // records is never matched; a phrase is looked up by its words and then matched as usual
+  bool use_index = !keywords_list.isEmpty() && (!kwTitle || titleWords) && (!kwReview || reviewWords);
+  bool verify = false;
 
-    // Check year
+  for(int k = 0; use_index && (k < keywords_list.size()); k++)
+    use_index = TextIndex::IsPhrase(keywords_list[k]);
 
-    int year = it->year.toInt();
+  if(!use_index)
+  {
+    plan.push_back(text_match);
+    return;
+  }
 
-    if(yearStart != -1)
-    {
-      if((year < yearStart) || (year > yearStop))
-      {
-        ++it;
-        continue;
-      }
-    }
+  QSet<int> candidates;
+  for(int k = 0; k < keywords_list.size(); k++)
+  {
+    QStringList phrase_words = TextIndex::Words(keywords_list[k]);
+    if(keywords_list[k].contains(u' ')) verify = true;
 
-    // Match if keyword is in title or review
+    if(kwTitle)  findWords(titleWords, phrase_words, &candidates);
+    if(kwReview) findWords(reviewWords, phrase_words, &candidates);
+  }
 
-    if(kwTitle || kwReview)
-    {
-      bool keyword_match = false;
+  plan.push_back({CostIndex, [candidates](const PaperMeta &r) { return(candidates.contains(r.recordId)); }});
 
-      // Make reg exp for matching keywords with word boundaries either side
+  // A single word needs no other match
+  if(verify) plan.push_back(text_match);
+}
 
-      QString search_expression = "\\b(";
-      for(int k = 0; k < keywords_list.size(); k++)
-      {
-        search_expression.append(keywords_list[k]);
-        if(k+1 < keywords_list.size())
-          search_expression.append("|");
-        else
-          search_expression.append(")\\b");
-      }
+// Add the tests for the query to the plan
+void Searcher::compileQuery()
+{
+  QSharedPointer<SearchQuery> query(new SearchQuery);
 
-      QRegularExpression search_regexp(search_expression,
-                                       QRegularExpression::CaseInsensitiveOption);
+  // The dialog checks the query before searching, so this only guards against a bad query
+  if(!query->Parse(queryText))
+  {
+    qDebug() << "Searcher: query is not valid:" << query->Error();
+    plan.push_back({CostPath, [](const PaperMeta &) { return(false); }});
+    return;
+  }
 
-      for(int k = 0; k < keywords_list.size(); k++)
-      {
-        if(kwTitle)
-        {
-          if(it->title.contains(search_regexp))
-          {
-            keyword_match = true;
-          }
-        }
-
-        if(kwReview)
-        {
-          if(it->review.contains(search_regexp))
-          {
-            keyword_match = true;
-          }
-        }
-      }
+  query->Compile(titleWords, reviewWords, records->size());
 
-      if(!keyword_match)
-      {
-        ++it;
-        continue;
-      }
-    }
+  // Records outside the intersection of the posting lists of the query's words cannot
+  // match, so most are ruled out without reading their text
+  QVector<int> candidates;
+  if(query->Candidates(&candidates))
+  {
+    plan.push_back({CostIndex, [candidates](const PaperMeta &r)
+    {
+      return(std::binary_search(candidates.begin(), candidates.end(), r.recordId));
+    }});
+  }
 
-    // Check match by author: only need one author to be a match
+  plan.push_back({query->Cost(), [query](const PaperMeta &r) { return(query->Matches(r)); }});
+}
 
-    if(!searchAuthors.isEmpty())
-    {
-      bool have_author = false;
+// Expression matching any of the terms with word boundaries either side; it is used with
+// UseUnicodePropertiesOption so \b agrees with the word indexes on accented letters
+QString Searcher::wordsExpression(const QStringList &terms)
+{
+  // No terms match nothing
+  if(terms.isEmpty()) return(QString("(?!)"));
 
-      // separate authors into QStringList of individual authors
-      QStringList author_list = searchAuthors.split(',', Qt::SkipEmptyParts);
+  return(QString("\\b(%1)\\b").arg(terms.join(u'|')));
+}
 
-      QString search_expression = "\\b(";
-      for(int k = 0; k < author_list.size(); k++)
-      {
-        search_expression.append(author_list[k].toLower());
-        if(k+1 < author_list.size())
-          search_expression.append("|");
-        else
-          search_expression.append(")\\b");
-      }
 
-      QRegularExpression search_regexp(search_expression,
-                                       QRegularExpression::CaseInsensitiveOption);
+// Remove all results
+void SearchResultModel::Clear()
+{
+  beginResetModel();
+  rows.clear();
+  endResetModel();
+}
 
-      for(int a = 0; a < author_list.size(); a++)
-      {
-        // if(it->authors.toLower().contains(search_regexp))
-        if(it->authors.contains(search_regexp))
-        {
-          have_author = true;
-          break;
-        }
-      }
+// Append a batch of results
+void SearchResultModel::Append(const QVector<int> &indexes)
+{
+  if(indexes.isEmpty()) return;
 
-      if(!have_author)
-      {
-        ++it;
-        continue;
-      }
-    }
+  // One insertion for the whole batch, so the view only lays out once
+  beginInsertRows(QModelIndex(), rows.size(), rows.size()+indexes.size()-1);
+  rows += indexes;
+  endInsertRows();
+}
 
-    // Must be a match if reach here
-    emit result(it->citation, it->title);
+// Citation keys of all results
+QStringList SearchResultModel::Citations() const
+{
+  QStringList citations;
+  citations.reserve(rows.size());
+  for(int r = 0; r < rows.size(); r++) citations << records->at(rows[r]).citation;
 
-    ++it;
-  }
+  return(citations);
+}
 
-  emit finished();
+// Number of results
+int SearchResultModel::rowCount(const QModelIndex &parent) const
+{
+  return(parent.isValid() ? 0 : rows.size());
 }
 
-// Stop
-void Searcher::halt()
+// Citation key of a result, with its title as the tool tip
+QVariant SearchResultModel::data(const QModelIndex &index, int role) const
 {
-  doRun = false;
+  if(!index.isValid() || (index.row() >= rows.size())) return(QVariant());
+
+  const PaperMeta &record = records->at(rows[index.row()]);
+  if(role == Qt::DisplayRole) return(record.citation);
+  if(role == Qt::ToolTipRole) return(record.title);
+
+  return(QVariant());
 }
 
 
 SearchDialog::SearchDialog(QWidget *parent) :
     QDialog(parent),
     ui(new Ui::SearchDialog),
+    database(nullptr),
+    citations(nullptr),
+    searching(false),
     searchIndex(0)
 {
   ui->setupUi(this);
 
+  resultModel = new SearchResultModel(this);
+  ui->citationResultsList->setModel(resultModel);
+
   loadSearchHistory();
 
   yearChange(0);
@@ -228,6 +396,7 @@ SearchDialog::SearchDialog(QWidget *parent) :
   connect(ui->yearCheck,         &QAbstractButton::toggled, this, &SearchDialog::searchTypeChanged);
   connect(ui->keywordsCheck,     &QAbstractButton::toggled, this, &SearchDialog::searchTypeChanged);
   connect(ui->paperPathCheck,    &QAbstractButton::toggled, this, &SearchDialog::searchTypeChanged);
+  connect(ui->queryCheck,        &QAbstractButton::toggled, this, &SearchDialog::searchTypeChanged);
 
   connect(ui->historyDownButton, &QToolButton::released,    this, &SearchDialog::navigateHistoryNext);
   connect(ui->historyUpButton,   &QToolButton::released,    this, &SearchDialog::navigateHistoryPrevious);
@@ -235,6 +404,14 @@ SearchDialog::SearchDialog(QWidget *parent) :
 
 SearchDialog::~SearchDialog()
 {
+  // The search reads the database, which may change once the dialog has gone
+  if(searching)
+  {
+    *halted = true;
+    searchThread->wait();
+    if(database) database->SetRecordsInUse(false);
+  }
+
   saveSearchHistory();
   delete ui;
 }
@@ -249,7 +426,7 @@ void SearchDialog::SetDatabaseYearRange(int first_year, int last_year)
 // Get results from search
 QStringList SearchDialog::GetResults()
 {
-  return(resultList);
+  return(resultModel->Citations());
 }
 
 // There was a change to the year range: enforce validity
@@ -276,12 +453,13 @@ void SearchDialog::setSearchParams(const QString &query)
 
   for(int i = 0; i < properties.size(); i++)
   {
-    QStringList kv = properties[i].split('=');
+    // Split at the first equals sign, a query can contain more
+    int equals = properties[i].indexOf('=');
 
-    if(kv.size() != 2) continue;
+    if(equals < 0) continue;
 
-    QString key = kv[0];
-    QString value = kv[1].mid(1, kv[1].size()-2); // remove brackets
+    QString key = properties[i].left(equals);
+    QString value = properties[i].mid(equals+2, properties[i].size()-equals-3); // remove brackets
 
     // De-escape semicolon : in case user puts semicolon in authors or keywords, it must be escaped.
     // We convert a ';' to "&;" when parameters are encoded
@@ -316,6 +494,12 @@ void SearchDialog::setSearchParams(const QString &query)
       ui->keywordsCheck->setChecked(true);
     }
 
+    // Query
+    if(key == "query") {
+      ui->queryEdit->setText(value);
+      ui->queryCheck->setChecked(true);
+    }
+
     // Path to paper
     if(key == "paper_path") {
       ui->paperPathEdit->setText(value);
@@ -327,8 +511,28 @@ void SearchDialog::setSearchParams(const QString &query)
 // Perform search
 void SearchDialog::search()
 {
-  ui->citationResultsList->clear();
-  resultList.clear();
+  // The button halts the search in progress instead; the flag outlives the searcher, so
+  // it is safe to set even as the search finishes
+  if(searching)
+  {
+    *halted = true;
+    return;
+  }
+
+  // A query that cannot be parsed is reported rather than searched for
+  if(ui->queryCheck->isChecked())
+  {
+    SearchQuery query;
+    if(!query.Parse(ui->queryEdit->text()))
+    {
+      ui->resultsStatusLabel->setText(tr("Query not valid: %1").arg(query.Error()));
+      return;
+    }
+  }
+
+  searching = true;
+
+  resultModel->Clear();
   numberResults = 0;
 
   ui->busyWidget->start();
@@ -339,9 +543,37 @@ void SearchDialog::search()
   searchThread = new QThread;
   searchThread->setObjectName("RefOrg-Search");
 
+  halted = QSharedPointer<std::atomic<bool>>::create(false);
+
   searchObj = new Searcher;
+  searchObj->SetHaltFlag(halted);
   searchObj->SetData(citations);
 
+  // A background save finishing during the search must not replace the records it reads
+  if(database) database->SetRecordsInUse(true);
+
+  // Keywords and queries read the text of the reviews and look words up in the indexes
+  if(database && (ui->keywordsCheck->isChecked() || ui->queryCheck->isChecked()))
+  {
+    // Reviews are fetched here as the storage belongs to this thread; the index builder
+    // on the search thread only reads the records
+    database->FetchAllReviews();
+
+    if(database->TitleWords())
+      searchObj->SetWordIndexes(database->TitleWords(), database->ReviewWords());
+    else
+    {
+      DatabaseHandler *handler = database;
+      searchObj->SetIndexBuilder([handler](const TextIndex **title, const TextIndex **review)
+      {
+        handler->IndexWords();
+        *title  = handler->TitleWords();
+        *review = handler->ReviewWords();
+      });
+      ui->resultsStatusLabel->setText(tr("Indexing words..."));
+    }
+  }
+
   if(ui->authorsCheck->isChecked())
   {
     QString authors = ui->authorsEdit->text();
@@ -372,6 +604,17 @@ void SearchDialog::search()
   else
     searchObj->SetKeywords("", false, false);
 
+  if(ui->queryCheck->isChecked())
+  {
+    QString query = ui->queryEdit->text().simplified();
+    searchObj->SetQuery(query);
+    query.replace(QString(";"), QString("&;")); // Escape semicolon
+    if(!search_params.isEmpty()) search_params.append(";");
+    search_params.append(QString("query=(%1)").arg(query));
+  }
+  else
+    searchObj->SetQuery("");
+
   if(ui->paperPathCheck->isChecked())
   {
     searchObj->SetPaperPath(ui->paperPathEdit->text());
@@ -389,10 +632,10 @@ void SearchDialog::search()
 
   searchObj->moveToThread(searchThread);
   connect(searchThread,     &QThread::started,      searchObj,    &Searcher::process);
-  connect(searchObj,        &Searcher::result,      this,         &SearchDialog::addResult);
-  connect(ui->searchButton, &QPushButton::released, searchObj,    &Searcher::halt);
+  connect(searchObj,        &Searcher::result,      this,         &SearchDialog::addResults);
   connect(searchObj,        &Searcher::finished,    this,         &SearchDialog::endSearch);
   connect(searchObj,        &Searcher::finished,    searchObj,    &Searcher::deleteLater);
+  connect(searchObj,        &Searcher::destroyed,   searchThread, &QThread::quit, Qt::DirectConnection);
   connect(searchThread,     &QThread::finished,     searchThread, &QThread::deleteLater);
   searchThread->start();
 
@@ -410,20 +653,19 @@ void SearchDialog::selectPaperPath()
   ui->paperPathEdit->setText(paper_path);
 }
 
-// Add a result from the search in progress
-void SearchDialog::addResult(const QString &cite, const QString &title)
+// Add a batch of results from the search in progress
+void SearchDialog::addResults(const QVector<int> &indexes)
 {
-  QListWidgetItem *element = new QListWidgetItem(ui->citationResultsList);
-  element->setText(cite);
-  element->setToolTip(title);
-  numberResults++;
-
-  resultList << cite;
+  resultModel->Append(indexes);
+  numberResults += indexes.size();
 }
 
 // Search has finished
 void SearchDialog::endSearch()
 {
+  searching = false;
+  if(database) database->SetRecordsInUse(false);
+
   // stop busywidget
   ui->busyWidget->stop();
   ui->resultsStatusLabel->setText(tr("%1 results found").arg(numberResults));
@@ -435,7 +677,8 @@ void SearchDialog::endSearch()
 void SearchDialog::searchTypeChanged(bool)
 {
   bool enable_search = ((ui->authorsCheck->isChecked()) || (ui->yearCheck->isChecked()) ||
-                        (ui->keywordsCheck->isChecked()) || (ui->paperPathCheck->isChecked()));
+                        (ui->keywordsCheck->isChecked()) || (ui->paperPathCheck->isChecked()) ||
+                        (ui->queryCheck->isChecked()));
 
   ui->searchButton->setEnabled(enable_search);
 }
@@ -480,10 +723,12 @@ void SearchDialog::clearParams()
   ui->yearCheck->setChecked(false);
   ui->keywordsCheck->setChecked(false);
   ui->paperPathCheck->setChecked(false);
+  ui->queryCheck->setChecked(false);
 
   ui->authorsEdit->clear();
   ui->keywordsEdit->clear();
   ui->paperPathEdit->clear();
+  ui->queryEdit->clear();
 
   ui->yearStartSpin->setValue(ui->yearStartSpin->minimum());
   ui->yearEndSpin->setValue(ui->yearEndSpin->maximum());
@@ -13,12 +13,32 @@
 #include <QStringList>
 #include <QThread>
 #include <QRegularExpression>
+#include <QAbstractListModel>
+#include <QSharedPointer>
+
+#include <functional>
+#include <atomic>
 
 #include "papermeta.h"
+#include "textindex.h"
+#include "searchquery.h"
+#include "databasehandler.h"
 
 /// Number of search queries that will be stored
 #define MAX_SIZE_SEARCH_HISTORY 20
 
+/// Fewest records given to a thread when searching in parallel
+#define SEARCH_MIN_CHUNK_SIZE 512
+
+/// Chunks of records per core, so a chunk of long reviews does not hold up the search
+#define SEARCH_CHUNKS_PER_THREAD 4
+
+/// Results held back to send together to the dialog
+#define SEARCH_RESULT_BATCH_SIZE 256
+
+/// Longest time in milliseconds that results are held back
+#define SEARCH_RESULT_BATCH_INTERVAL 100
+
 /**
  * @brief Object to perform search in another thread
  */
@@ -33,6 +53,19 @@ public:
   /// Set the data to search
   void SetData(const QVector<PaperMeta> *recs) { records = recs; }
 
+  /// Indexes of the words in the titles and reviews of the records, nullptr if not built
+  void SetWordIndexes(const TextIndex *title, const TextIndex *review)
+  {
+    titleWords  = title;
+    reviewWords = review;
+  }
+
+  /// Builds the word indexes and sets the indexes to them
+  typedef std::function<void(const TextIndex **title, const TextIndex **review)> IndexBuilder;
+
+  /// Build the word indexes on the search thread before searching, rather than set them
+  void SetIndexBuilder(const IndexBuilder &builder) { indexBuilder = builder; }
+
   /// Set search terms
   void SetKeywords(const QString &words, bool title, bool review)
   {
@@ -50,16 +83,22 @@ public:
   /// Path to paper saught
   void SetPaperPath(const QString &path) { paperFile = path; }
 
+  /// Query in the search language of SearchQuery, empty for none
+  void SetQuery(const QString &text) { queryText = text; }
+
+  /**
+   * Flag that stops the search once set. It is shared with the thread that started the
+   * search, which can set it at any time, even after the searcher has been deleted.
+   */
+  void SetHaltFlag(const QSharedPointer<std::atomic<bool>> &flag) { halted = flag; }
+
 public slots:
   /// Begin search
   void process();
 
-  /// Stop
-  void halt();
-
 signals:
-  /// A result
-  void result(const QString &cite, const QString &title);
+  /// A batch of results, indexes of the records in citation order
+  void result(const QVector<int> &indexes);
 
   /// Search is finished
   void finished();
@@ -68,6 +107,12 @@ private:
   /// A pointer to the main database
   const QVector<PaperMeta> *records;
 
+  /// Words of the titles and reviews, keywords are looked up here if available
+  const TextIndex *titleWords, *reviewWords;
+
+  /// Builds the word indexes before the search, if they are not built yet
+  IndexBuilder indexBuilder;
+
   /// Keywords that are being searched for
   QString keywords;
 
@@ -80,8 +125,81 @@ private:
 
   QString paperFile;
 
-  /// Keep the search running
-  bool doRun;
+  /// Query in the search language
+  QString queryText;
+
+  /// Stop the search, read by every thread searching
+  QSharedPointer<std::atomic<bool>> halted;
+
+  /// Relative cost of a test of each record; tests are run cheapest first
+  enum StepCost
+  {
+    CostPath    = 1,                   ///< Compare the paper path
+    CostYear    = 2,                   ///< Convert and compare the year
+    CostIndex   = 3,                   ///< Look the record up in the results from the word indexes
+    CostAuthors = 10,                  ///< Match an expression against the authors
+    CostTitle   = 20,                  ///< Match an expression against the title
+    CostReview  = 100                  ///< Match an expression against the title and the review
+  };
+
+  /// Test of a record, part of a compiled search
+  struct SearchStep
+  {
+    int cost;                                      ///< StepCost of the test
+    std::function<bool(const PaperMeta &)> test;   ///< Record passes the test
+  };
+
+  /// Build the tests of the search from the parameters, before any record is checked
+  void compile();
+
+  /// Add the tests for the keywords to the plan
+  void compileKeywords();
+
+  /// Add the tests for the query to the plan
+  void compileQuery();
+
+  /// Record passes every test of the compiled search
+  bool test(const PaperMeta &record) const;
+
+  /// Indexes of the records from first up to last that match, stopping early if halted
+  QVector<int> scanRange(int first, int last) const;
+
+  /// Expression matching any of the terms with word boundaries either side
+  static QString wordsExpression(const QStringList &terms);
+
+  /// Tests of the compiled search, in the order they are run
+  QVector<SearchStep> plan;
+};
+
+
+/**
+ * @brief Results of a search, shown by the dialog without copying the records
+ */
+class SearchResultModel : public QAbstractListModel
+{
+  Q_OBJECT
+
+public:
+  explicit SearchResultModel(QObject *parent = nullptr) : QAbstractListModel(parent), records(nullptr) { }
+
+  /// Set the records that results are indexes of
+  void SetRecords(const QVector<PaperMeta> *recs) { records = recs; }
+
+  /// Remove all results
+  void Clear();
+
+  /// Append a batch of results
+  void Append(const QVector<int> &indexes);
+
+  /// Citation keys of all results
+  QStringList Citations() const;
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private:
+  const QVector<PaperMeta> *records;   ///< Records searched
+  QVector<int>              rows;      ///< Index of the record of each result
 };
 
 
@@ -100,10 +218,16 @@ public:
   explicit SearchDialog(QWidget *parent = 0);
   ~SearchDialog();
 
-  /// Set the records that can be searched
-  void SetRecords(const QVector<PaperMeta> &recs)
+  /**
+   * Set the database to search. Its reviews are fetched and its words indexed by the first
+   * search of the text, so searches by author, year or paper do neither. The database must
+   * not change while the dialog is open.
+   */
+  void SetDatabase(DatabaseHandler *handler)
   {
-    citations = &recs;
+    database  = handler;
+    citations = &handler->Records();
+    resultModel->SetRecords(citations);
   }
 
   /// Get results from search
@@ -128,8 +252,8 @@ private slots:
   /// Open dialog to select a paper
   void selectPaperPath();
 
-  /// Add a result from the search in progress
-  void addResult(const QString &cite, const QString &title);
+  /// Add a batch of results from the search in progress
+  void addResults(const QVector<int> &indexes);
 
   /// Search has finished
   void endSearch();
@@ -156,8 +280,11 @@ private:
   QThread  *searchThread;
   Searcher *searchObj;
 
+  DatabaseHandler *database;
   const QVector<PaperMeta> *citations;
-  QStringList resultList;
+  bool searching;         ///< A search is running
+  QSharedPointer<std::atomic<bool>> halted;  ///< Stops the search running, shared with its searcher
+  SearchResultModel *resultModel;
   QStringList searches;
 
   QString papersReadDir;
@@ -0,0 +1,707 @@
+/**
+ * @file   searchquery.cpp
+ * @brief  Search query with Boolean operators and fields
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include <algorithm>
+#include <iterator>
+
+#include <QStringView>
+
+#include "searchquery.h"
+
+/// Relative cost of matching a term against a record, on the same scale as the search's steps
+enum TermCost
+{
+  CostNumber  = 1,                     ///< Compare a year or rating
+  CostVenue   = 2,                     ///< Compare the type of venue
+  CostIndexed = 3,                     ///< Look a word up in the posting lists of an index
+  CostTag     = 5,                     ///< Compare the tags
+  CostPhrase  = 8,                     ///< Look the words up, then match the text the words are in
+  CostAuthors = 10,                    ///< Match an expression against the authors or publication
+  CostTitle   = 20,                    ///< Match an expression against the title
+  CostReview  = 100                    ///< Match an expression against the review
+};
+
+// Names of the fields a term can look in
+static const QStringList queryFields = { "title", "review", "author", "authors", "tag", "tags", "venue", "year", "rating" };
+
+// Names of the types of venue, as written in the database file
+static const struct
+{
+  const char *name;
+  VenueType   type;
+} venueNames[] =
+{
+  { "Journal",       VenueType::Journal },
+  { "Conference",    VenueType::Conference },
+  { "Symposium",     VenueType::Symposium },
+  { "Book",          VenueType::Book },
+  { "Preprint",      VenueType::Preprint },
+  { "Thesis",        VenueType::Thesis },
+  { "Report",        VenueType::Report },
+  { "SelfPublished", VenueType::SelfPublished },
+  { "NotPublished",  VenueType::NotPublished },
+  { "None",          VenueType::NoVenue },
+  { "Unknown",       VenueType::UnknownVenue }
+};
+
+// Parse a query
+bool SearchQuery::Parse(const QString &text)
+{
+  delete root;
+  root = nullptr;
+  error.clear();
+
+  if(!tokenize(text)) return(false);
+
+  if(tokens.isEmpty())
+  {
+    error = QString("The query is empty");
+    return(false);
+  }
+
+  position = 0;
+  root = parseOr();
+
+  if(root && (position < tokens.size()))
+  {
+    error = (tokens[position].kind == Token::Close) ? QString("Unexpected closing bracket")
+                                                     : QString("Unexpected %1").arg(tokens[position].value);
+    delete root;
+    root = nullptr;
+  }
+
+  tokens.clear();
+
+  return(root != nullptr);
+}
+
+// Split a query into tokens
+bool SearchQuery::tokenize(const QString &text)
+{
+  tokens.clear();
+
+  qsizetype c = 0;
+  while(c < text.size())
+  {
+    QChar ch = text[c];
+
+    if(ch.isSpace())
+    {
+      c++;
+      continue;
+    }
+
+    if((ch == u'(') || (ch == u')'))
+    {
+      tokens.push_back({(ch == u'(') ? Token::Open : Token::Close, QString(), QString(ch)});
+      c++;
+      continue;
+    }
+
+    // A minus before a term negates it
+    if((ch == u'-') && (c+1 < text.size()) && !text[c+1].isSpace())
+    {
+      tokens.push_back({Token::Not, QString(), QString("-")});
+      c++;
+      continue;
+    }
+
+    QString field;
+    if(ch != u'"')
+    {
+      qsizetype start = c;
+      while((c < text.size()) && !text[c].isSpace() && (text[c] != u'(') && (text[c] != u')') && (text[c] != u'"')) c++;
+
+      QString word = text.mid(start, c-start);
+
+      // Field prefix; a colon after anything else is part of the word
+      qsizetype colon = word.indexOf(u':');
+      if((colon > 0) && queryFields.contains(word.left(colon), Qt::CaseInsensitive))
+      {
+        field = word.left(colon).toLower();
+        word  = word.mid(colon+1);
+      }
+
+      // An empty value is only allowed if a quoted value follows the field
+      if(word.isEmpty())
+      {
+        if((c >= text.size()) || (text[c] != u'"'))
+        {
+          error = QString("No value for %1:").arg(field);
+          return(false);
+        }
+      }
+      else
+      {
+        // Operators are only recognised in capitals, so the words can still be searched for
+        if(field.isEmpty() && (word == QLatin1String("AND")))
+          tokens.push_back({Token::And, field, word});
+        else if(field.isEmpty() && (word == QLatin1String("OR")))
+          tokens.push_back({Token::Or, field, word});
+        else if(field.isEmpty() && (word == QLatin1String("NOT")))
+          tokens.push_back({Token::Not, field, word});
+        else
+          tokens.push_back({Token::Word, field, word});
+
+        continue;
+      }
+    }
+
+    // Quoted phrase
+    qsizetype end = text.indexOf(u'"', c+1);
+    if(end < 0)
+    {
+      error = QString("A phrase has no closing quote");
+      return(false);
+    }
+
+    QString phrase = text.mid(c+1, end-c-1).simplified();
+    c = end+1;
+
+    if(phrase.isEmpty())
+    {
+      error = QString("A phrase is empty");
+      return(false);
+    }
+
+    tokens.push_back({Token::Word, field, phrase});
+  }
+
+  return(true);
+}
+
+// Parse terms joined by OR
+SearchQuery::Node *SearchQuery::parseOr()
+{
+  Node *left = parseAnd();
+  if(!left) return(nullptr);
+
+  if((position >= tokens.size()) || (tokens[position].kind != Token::Or)) return(left);
+
+  Node *node = new Node(Node::Or);
+  node->children.push_back(left);
+
+  while((position < tokens.size()) && (tokens[position].kind == Token::Or))
+  {
+    position++;
+
+    Node *right = parseAnd();
+    if(!right)
+    {
+      delete node;
+      return(nullptr);
+    }
+    node->children.push_back(right);
+  }
+
+  return(node);
+}
+
+// Parse terms joined by AND or nothing
+SearchQuery::Node *SearchQuery::parseAnd()
+{
+  QVector<Node *> children;
+
+  while(position < tokens.size())
+  {
+    Token::Kind kind = tokens[position].kind;
+
+    if(kind == Token::And)
+    {
+      if(children.isEmpty())
+      {
+        error = QString("AND has no term before it");
+        return(nullptr);
+      }
+      position++;
+    }
+    else if((kind == Token::Or) || (kind == Token::Close))
+      break;
+
+    Node *child = parseUnary();
+    if(!child)
+    {
+      qDeleteAll(children);
+      return(nullptr);
+    }
+    children.push_back(child);
+  }
+
+  if(children.isEmpty())
+  {
+    if(error.isEmpty()) error = QString("A term is missing");
+    return(nullptr);
+  }
+
+  if(children.size() == 1) return(children[0]);
+
+  Node *node = new Node(Node::And);
+  node->children = children;
+
+  return(node);
+}
+
+// Parse a negated, bracketed or single term
+SearchQuery::Node *SearchQuery::parseUnary()
+{
+  if(position >= tokens.size())
+  {
+    error = QString("A term is missing at the end");
+    return(nullptr);
+  }
+
+  const Token &token = tokens[position++];
+
+  switch(token.kind)
+  {
+    case Token::Not:
+    {
+      Node *child = parseUnary();
+      if(!child) return(nullptr);
+
+      Node *node = new Node(Node::Not);
+      node->children.push_back(child);
+      return(node);
+    }
+
+    case Token::Open:
+    {
+      Node *node = parseOr();
+      if(!node) return(nullptr);
+
+      if((position >= tokens.size()) || (tokens[position].kind != Token::Close))
+      {
+        error = QString("A bracket is not closed");
+        delete node;
+        return(nullptr);
+      }
+      position++;
+      return(node);
+    }
+
+    case Token::Word:
+      return(parseTerm(token));
+
+    default:
+      error = QString("A term is missing before %1").arg(token.value);
+      return(nullptr);
+  }
+}
+
+// Parse a word or field and value
+SearchQuery::Node *SearchQuery::parseTerm(const Token &token)
+{
+  Node *node = new Node(Node::Term);
+  node->value = token.value;
+
+  const QString &field = token.field;
+  if(field == QLatin1String("title"))                                           node->field = Node::Title;
+  else if(field == QLatin1String("review"))                                     node->field = Node::Review;
+  else if((field == QLatin1String("author")) || (field == QLatin1String("authors"))) node->field = Node::Author;
+  else if((field == QLatin1String("tag")) || (field == QLatin1String("tags")))  node->field = Node::Tag;
+  else if(field == QLatin1String("venue"))                                      node->field = Node::Venue;
+  else if(field == QLatin1String("year"))                                       node->field = Node::Year;
+  else if(field == QLatin1String("rating"))                                     node->field = Node::Rating;
+
+  if(((node->field == Node::Year) || (node->field == Node::Rating)) && !parseNumber(node->value, node))
+  {
+    error = QString("%1: needs a number, a comparison such as >5 or a range such as 1..5").arg(field);
+    delete node;
+    return(nullptr);
+  }
+
+  return(node);
+}
+
+// Parse the number, comparison or range of a year or rating term
+bool SearchQuery::parseNumber(const QString &value, Node *node)
+{
+  bool low_ok = false, high_ok = true;
+
+  qsizetype range = value.indexOf(QLatin1String(".."));
+  if(range >= 0)
+  {
+    node->compare = Node::Between;
+    node->low     = value.left(range).toInt(&low_ok);
+    node->high    = value.mid(range+2).toInt(&high_ok);
+    if(node->low > node->high) std::swap(node->low, node->high);
+  }
+  else if(value.startsWith(QLatin1String(">=")))
+  {
+    node->compare = Node::GreaterEqual;
+    node->low     = value.mid(2).toInt(&low_ok);
+  }
+  else if(value.startsWith(QLatin1String("<=")))
+  {
+    node->compare = Node::LessEqual;
+    node->low     = value.mid(2).toInt(&low_ok);
+  }
+  else if(value.startsWith(u'>'))
+  {
+    node->compare = Node::Greater;
+    node->low     = value.mid(1).toInt(&low_ok);
+  }
+  else if(value.startsWith(u'<'))
+  {
+    node->compare = Node::Less;
+    node->low     = value.mid(1).toInt(&low_ok);
+  }
+  else
+  {
+    node->compare = Node::Equal;
+    node->low     = value.mid(value.startsWith(u'=') ? 1 : 0).toInt(&low_ok);
+  }
+
+  return(low_ok && high_ok);
+}
+
+// Prepare the query for matching
+void SearchQuery::Compile(const TextIndex *title_words, const TextIndex *review_words, int record_count)
+{
+  titleWords  = title_words;
+  reviewWords = review_words;
+  recordCount = record_count;
+
+  if(root) compile(root);
+}
+
+// Build the expressions of a node and order its children
+void SearchQuery::compile(Node *node)
+{
+  if(node->type != Node::Term)
+  {
+    for(int c = 0; c < node->children.size(); c++) compile(node->children[c]);
+
+    if(node->type == Node::Not)
+    {
+      node->cost     = node->children[0]->cost;
+      node->estimate = qMax(qint64(0), recordCount-node->children[0]->estimate);
+      return;
+    }
+
+    // Children are checked in the order that costs least on average: an AND stops at the
+    // first child that fails, an OR at the first that matches
+    bool conjunction = (node->type == Node::And);
+    auto expected = [this, conjunction](const Node *n)
+    {
+      double matching = (recordCount > 0) ? double(n->estimate)/recordCount : 1.0;
+      double stops    = conjunction ? 1.0-matching : matching;
+      return(n->cost/qMax(stops, 0.001));
+    };
+    std::stable_sort(node->children.begin(), node->children.end(),
+                     [&expected](const Node *a, const Node *b) { return(expected(a) < expected(b)); });
+
+    node->cost     = 0;
+    node->estimate = conjunction ? recordCount : 0;
+    for(int c = 0; c < node->children.size(); c++)
+    {
+      node->cost += node->children[c]->cost;
+      if(conjunction)
+        node->estimate = qMin(node->estimate, node->children[c]->estimate);
+      else
+        node->estimate = qMin(qint64(recordCount), node->estimate+node->children[c]->estimate);
+    }
+    return;
+  }
+
+  node->estimate = recordCount;
+
+  switch(node->field)
+  {
+    case Node::Year:
+    case Node::Rating:
+      node->cost = CostNumber;
+      return;
+
+    case Node::Tag:
+      node->cost = CostTag;
+      return;
+
+    case Node::Venue:
+      for(const auto &venue : venueNames)
+      {
+        if(node->value.compare(QLatin1String(venue.name), Qt::CaseInsensitive) == 0)
+        {
+          node->venueType = true;
+          node->venue     = venue.type;
+          node->cost      = CostVenue;
+          return;
+        }
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  // The value is matched with no word characters either side, the words of a phrase
+  // separated by any white space; word characters are Unicode letters and digits, as
+  // in the word indexes, so accented words match the same on both paths
+  QStringList parts = node->value.split(u' ', Qt::SkipEmptyParts);
+  for(int p = 0; p < parts.size(); p++) parts[p] = QRegularExpression::escape(parts[p]);
+
+  node->expression.setPattern(QString("(?<!\\w)%1(?!\\w)").arg(parts.join(QLatin1String("\\s+"))));
+  node->expression.setPatternOptions(QRegularExpression::CaseInsensitiveOption |
+                                     QRegularExpression::UseUnicodePropertiesOption);
+  node->expression.optimize();
+
+  if((node->field == Node::Author) || (node->field == Node::Venue))
+  {
+    node->cost = CostAuthors;
+    return;
+  }
+
+  node->phrase = TextIndex::IsPhrase(node->value);
+  if(node->phrase) node->words = TextIndex::Words(node->value);
+
+  const TextIndex *title  = (node->field == Node::Review) ? nullptr : titleWords;
+  const TextIndex *review = (node->field == Node::Title)  ? nullptr : reviewWords;
+  node->indexed = node->phrase && ((node->field == Node::Review) || title) && ((node->field == Node::Title) || review);
+
+  if(node->indexed)
+  {
+    node->cost = node->value.contains(u' ') ? CostPhrase : CostIndexed;
+    node->estimate = qMin(qint64(recordCount), estimateWords(node, title)+estimateWords(node, review));
+  }
+  else
+    node->cost = (node->field == Node::Title) ? CostTitle : CostReview;
+}
+
+// Estimated number of records with all the words of a term in an index
+qint64 SearchQuery::estimateWords(const Node *node, const TextIndex *index) const
+{
+  if(!index) return(0);
+
+  // No more records than have the rarest word
+  qint64 estimate = recordCount;
+  for(int w = 0; w < node->words.size(); w++)
+  {
+    const QVector<int> *postings = index->Postings(node->words[w]);
+    estimate = qMin(estimate, qint64(postings ? postings->size() : 0));
+  }
+
+  return(estimate);
+}
+
+// IDs of the only records that can match
+bool SearchQuery::Candidates(QVector<int> *ids) const
+{
+  ids->clear();
+  if(!root) return(false);
+
+  return(candidates(root, ids));
+}
+
+// IDs of the records that can match a node, false if the node does not limit them
+bool SearchQuery::candidates(const Node *node, QVector<int> *ids) const
+{
+  switch(node->type)
+  {
+    case Node::And:
+    {
+      // Start from the most selective child, so the lists being intersected stay short
+      QVector<const Node *> children(node->children.begin(), node->children.end());
+      std::stable_sort(children.begin(), children.end(),
+                       [](const Node *a, const Node *b) { return(a->estimate < b->estimate); });
+
+      bool limited = false;
+      for(int c = 0; c < children.size(); c++)
+      {
+        QVector<int> child_ids;
+        if(!candidates(children[c], &child_ids)) continue;
+
+        if(!limited)
+          *ids = child_ids;
+        else
+        {
+          QVector<int> both;
+          std::set_intersection(ids->begin(), ids->end(), child_ids.begin(), child_ids.end(), std::back_inserter(both));
+          *ids = both;
+        }
+        limited = true;
+
+        if(ids->isEmpty()) break;
+      }
+      return(limited);
+    }
+
+    case Node::Or:
+    {
+      // Every alternative must be limited, or any record could match
+      for(int c = 0; c < node->children.size(); c++)
+      {
+        QVector<int> child_ids;
+        if(!candidates(node->children[c], &child_ids)) return(false);
+
+        QVector<int> either;
+        std::set_union(ids->begin(), ids->end(), child_ids.begin(), child_ids.end(), std::back_inserter(either));
+        *ids = either;
+      }
+      return(true);
+    }
+
+    case Node::Not:
+      return(false);
+
+    case Node::Term:
+      break;
+  }
+
+  if(!node->indexed) return(false);
+
+  if(node->field == Node::Title)
+    *ids = findWords(node, titleWords);
+  else if(node->field == Node::Review)
+    *ids = findWords(node, reviewWords);
+  else
+  {
+    QVector<int> title_ids  = findWords(node, titleWords);
+    QVector<int> review_ids = findWords(node, reviewWords);
+    std::set_union(title_ids.begin(), title_ids.end(), review_ids.begin(), review_ids.end(), std::back_inserter(*ids));
+  }
+
+  return(true);
+}
+
+// IDs of the records with all the words of a term in an index
+QVector<int> SearchQuery::findWords(const Node *node, const TextIndex *index)
+{
+  QVector<int> ids;
+
+  // Start from the rarest word and check the others only for its records
+  QVector<const QVector<int> *> lists;
+  for(int w = 0; w < node->words.size(); w++)
+  {
+    const QVector<int> *postings = index->Postings(node->words[w]);
+    if(!postings) return(ids);
+    lists.push_back(postings);
+  }
+  if(lists.isEmpty()) return(ids);
+
+  std::sort(lists.begin(), lists.end(), [](const QVector<int> *a, const QVector<int> *b) { return(a->size() < b->size()); });
+
+  for(int id : *lists[0])
+  {
+    bool all = true;
+    for(int l = 1; all && (l < lists.size()); l++)
+      all = std::binary_search(lists[l]->begin(), lists[l]->end(), id);
+
+    if(all) ids.push_back(id);
+  }
+
+  return(ids);
+}
+
+// Record matches the query
+bool SearchQuery::Matches(const PaperMeta &record) const
+{
+  return(root && matches(root, record));
+}
+
+// Record matches a node
+bool SearchQuery::matches(const Node *node, const PaperMeta &record) const
+{
+  switch(node->type)
+  {
+    case Node::And:
+      for(int c = 0; c < node->children.size(); c++)
+      {
+        if(!matches(node->children[c], record)) return(false);
+      }
+      return(true);
+
+    case Node::Or:
+      for(int c = 0; c < node->children.size(); c++)
+      {
+        if(matches(node->children[c], record)) return(true);
+      }
+      return(false);
+
+    case Node::Not:
+      return(!matches(node->children[0], record));
+
+    case Node::Term:
+      break;
+  }
+
+  switch(node->field)
+  {
+    case Node::Text:
+      return(matchText(node, titleWords, record.title, record.recordId) ||
+             matchText(node, reviewWords, record.review, record.recordId));
+
+    case Node::Title:
+      return(matchText(node, titleWords, record.title, record.recordId));
+
+    case Node::Review:
+      return(matchText(node, reviewWords, record.review, record.recordId));
+
+    case Node::Author:
+      return(record.authors.contains(node->expression));
+
+    case Node::Tag:
+    {
+      const QList<QStringView> tags = QStringView(record.tags).split(u',', Qt::SkipEmptyParts);
+      for(QStringView tag : tags)
+      {
+        if(tag.trimmed().compare(node->value, Qt::CaseInsensitive) == 0) return(true);
+      }
+      return(false);
+    }
+
+    case Node::Venue:
+      if(node->venueType) return(record.venue == node->venue);
+      return(record.publication.contains(node->expression));
+
+    case Node::Year:
+    {
+      // Records without a year never match
+      bool ok = false;
+      int year = record.year.toInt(&ok);
+      return(ok && (year > 0) && matchNumber(node, year));
+    }
+
+    case Node::Rating:
+      return(matchNumber(node, record.reader.rating));
+  }
+
+  return(false);
+}
+
+// Text of a record matches a word or phrase
+bool SearchQuery::matchText(const Node *node, const TextIndex *index, const QString &text, int id)
+{
+  if(node->phrase && index)
+  {
+    for(int w = 0; w < node->words.size(); w++)
+    {
+      const QVector<int> *postings = index->Postings(node->words[w]);
+      if(!postings || !std::binary_search(postings->begin(), postings->end(), id)) return(false);
+    }
+
+    // The index has the whole answer for a single word
+    if(!node->value.contains(u' ')) return(true);
+  }
+
+  return(text.contains(node->expression));
+}
+
+// Number matches a year or rating term
+bool SearchQuery::matchNumber(const Node *node, int number)
+{
+  switch(node->compare)
+  {
+    case Node::Equal:        return(number == node->low);
+    case Node::Less:         return(number < node->low);
+    case Node::LessEqual:    return(number <= node->low);
+    case Node::Greater:      return(number > node->low);
+    case Node::GreaterEqual: return(number >= node->low);
+    case Node::Between:      return((number >= node->low) && (number <= node->high));
+  }
+
+  return(false);
+}
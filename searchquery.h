@@ -0,0 +1,158 @@
+/**
+ * @file   searchquery.h
+ * @brief  Search query with Boolean operators and fields
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#ifndef SEARCHQUERY_H
+#define SEARCHQUERY_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QRegularExpression>
+
+#include "papermeta.h"
+#include "textindex.h"
+
+/**
+ * @brief Search query with Boolean operators and fields
+ *
+ * A query is a list of terms that must all match. A term is a word, a "quoted phrase" or
+ * a field and its value:
+ *  - title:, review:, author: look for a word or phrase in that field only; a bare term
+ *    looks in the title and the review
+ *  - tag: matches one of the tags of a record
+ *  - venue: matches a type of venue, such as journal or conference, or else words of
+ *    the publication
+ *  - year: and rating: take a number, a comparison such as >7 or <=2000, or a range
+ *    such as 2019..2023
+ *
+ * Terms are combined with AND, OR and NOT, written in capitals, and brackets; a leading
+ * minus also negates a term. Words and phrases are looked up in the word indexes where
+ * they are available, so the records a query can match are found without reading them.
+ */
+class SearchQuery
+{
+public:
+  SearchQuery() : root(nullptr), position(0), titleWords(nullptr), reviewWords(nullptr), recordCount(0) { }
+  ~SearchQuery() { delete root; }
+
+  Q_DISABLE_COPY(SearchQuery)
+
+  /// Parse a query, returns false if it is not valid
+  bool Parse(const QString &text);
+
+  /// Why the last query could not be parsed
+  QString Error() const { return(error); }
+
+  /**
+   * Prepare the query for matching: build its expressions and order the terms so the
+   * most selective, cheapest terms are checked first
+   * @param title_words   Index of the words in titles, or nullptr
+   * @param review_words  Index of the words in reviews, or nullptr
+   * @param record_count  Number of records searched, to estimate how selective terms are
+   */
+  void Compile(const TextIndex *title_words, const TextIndex *review_words, int record_count);
+
+  /**
+   * IDs of the only records that can match, in ascending order, found by intersecting the
+   * posting lists of the indexed terms
+   * @return false if the query has no indexed terms that limit the records
+   */
+  bool Candidates(QVector<int> *ids) const;
+
+  /// Record matches the query
+  bool Matches(const PaperMeta &record) const;
+
+  /// Relative cost of matching a record, as the search's step costs
+  int Cost() const { return(root ? root->cost : 0); }
+
+private:
+  /// Part of a query
+  struct Token
+  {
+    enum Kind { Word, Open, Close, And, Or, Not };
+
+    Kind    kind;
+    QString field;                     ///< Field of a word, empty for none
+    QString value;                     ///< Word or phrase
+  };
+
+  /// Node of a parsed query
+  struct Node
+  {
+    enum Type { And, Or, Not, Term };
+    enum Field { Text, Title, Review, Author, Tag, Venue, Year, Rating };
+    enum Compare { Equal, Less, LessEqual, Greater, GreaterEqual, Between };
+
+    Node(Type t) : type(t), field(Text), phrase(false), indexed(false), compare(Equal), low(0), high(0),
+                   venueType(false), venue(VenueType::UnknownVenue), cost(0), estimate(0) { }
+    ~Node() { qDeleteAll(children); }
+
+    Type                type;
+    QVector<Node *>     children;      ///< Operands of And, Or and Not
+    Field               field;         ///< Field a term looks in
+    QString             value;         ///< Value of a term
+    QStringList         words;         ///< Case folded words of a phrase, looked up in the indexes
+    bool                phrase;        ///< Value is made of words, so the indexes can find it
+    bool                indexed;       ///< Records a term can match are found from the word indexes
+    QRegularExpression  expression;    ///< Matches the value in text
+    Compare             compare;       ///< How a year or rating is compared
+    int                 low, high;     ///< Numbers a year or rating is compared with
+    bool                venueType;     ///< Venue term names a type of venue rather than words
+    VenueType           venue;         ///< Type of venue
+    int                 cost;          ///< Relative cost of matching a record
+    qint64              estimate;      ///< Estimated number of records matching
+  };
+
+  /// Split a query into tokens
+  bool tokenize(const QString &text);
+
+  /// Parse terms joined by OR
+  Node *parseOr();
+
+  /// Parse terms joined by AND or nothing
+  Node *parseAnd();
+
+  /// Parse a negated, bracketed or single term
+  Node *parseUnary();
+
+  /// Parse a word or field and value
+  Node *parseTerm(const Token &token);
+
+  /// Parse the number, comparison or range of a year or rating term
+  bool parseNumber(const QString &value, Node *node);
+
+  /// Build the expressions of a node and order its children
+  void compile(Node *node);
+
+  /// Estimated number of records with all the words of a term in an index
+  qint64 estimateWords(const Node *node, const TextIndex *index) const;
+
+  /// IDs of the records that can match a node, false if the node does not limit them
+  bool candidates(const Node *node, QVector<int> *ids) const;
+
+  /// IDs of the records with all the words of a term in an index
+  static QVector<int> findWords(const Node *node, const TextIndex *index);
+
+  /// Record matches a node
+  bool matches(const Node *node, const PaperMeta &record) const;
+
+  /// Text of a record matches a word or phrase, checked in the index first if there is one
+  static bool matchText(const Node *node, const TextIndex *index, const QString &text, int id);
+
+  /// Number matches a year or rating term
+  static bool matchNumber(const Node *node, int number);
+
+  Node           *root;                ///< Parsed query
+  QString         error;               ///< Why the query could not be parsed
+  QVector<Token>  tokens;              ///< Tokens being parsed
+  int             position;            ///< Next token to parse
+  const TextIndex *titleWords;         ///< Words of the titles, nullptr if not indexed
+  const TextIndex *reviewWords;        ///< Words of the reviews, nullptr if not indexed
+  int             recordCount;         ///< Number of records searched
+};
+
+#endif  // SEARCHQUERY_H
@@ -0,0 +1,348 @@
+/**
+ * @file   sqlitestorage.cpp
+ * @brief  Database stored as an SQLite file
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include <QFile>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QDebug>
+
+#include "sqlitestorage.h"
+
+// Record columns, in the order they are bound and read
+static const char *recordColumns[] =
+{
+  "citation", "review", "paperPath", "venue", "authors", "title", "publication", "volume", "issue",
+  "month", "year", "dates", "pageStart", "pageEnd", "url", "thesis", "institution", "location",
+  "publisher", "isbn", "doi", "note", "reviewDate", "tags", "reviewed", "finished", "understanding",
+  "rating", "accept", "suitability", "correctness", "novelty", "clarity", "relevance", "corrections",
+  "authorComments", "editorComments"
+};
+
+static const int recordColumnCount = sizeof(recordColumns)/sizeof(recordColumns[0]);
+
+// Tables, and the index of citation keys that changes find their row with
+static const char *schema[] =
+{
+  "CREATE TABLE IF NOT EXISTS meta (key TEXT PRIMARY KEY, value TEXT)",
+  "CREATE TABLE IF NOT EXISTS records (citation TEXT NOT NULL, review TEXT, paperPath TEXT, venue INTEGER, "
+  "authors TEXT, title TEXT, publication TEXT, volume TEXT, issue TEXT, month TEXT, year TEXT, dates TEXT, "
+  "pageStart TEXT, pageEnd TEXT, url TEXT, thesis INTEGER, institution TEXT, location TEXT, publisher TEXT, "
+  "isbn TEXT, doi TEXT, note TEXT, reviewDate TEXT, tags TEXT, reviewed INTEGER, finished INTEGER, "
+  "understanding INTEGER, rating INTEGER, accept INTEGER, suitability INTEGER, correctness INTEGER, "
+  "novelty INTEGER, clarity INTEGER, relevance INTEGER, corrections INTEGER, authorComments TEXT, "
+  "editorComments TEXT)",
+  "CREATE INDEX IF NOT EXISTS records_citation ON records (citation)"
+};
+
+// Column list of the records table
+static QString columnList()
+{
+  QString columns;
+  for(int c = 0; c < recordColumnCount; c++)
+  {
+    if(c > 0) columns.append(", ");
+    columns.append(recordColumns[c]);
+  }
+
+  return(columns);
+}
+
+// Placeholder for each column
+static QString placeholderList()
+{
+  QString placeholders;
+  for(int c = 0; c < recordColumnCount; c++)
+    placeholders.append((c > 0) ? ", ?" : "?");
+
+  return(placeholders);
+}
+
+// Assignment of a placeholder to each column
+static QString assignmentList()
+{
+  QString assignments;
+  for(int c = 0; c < recordColumnCount; c++)
+  {
+    if(c > 0) assignments.append(", ");
+    assignments.append(recordColumns[c]).append(" = ?");
+  }
+
+  return(assignments);
+}
+
+// Destructor
+SqliteStorage::~SqliteStorage()
+{
+  if(connectionName.isEmpty()) return;
+
+  // The connection can only be removed once nothing refers to it
+  database.close();
+  database = QSqlDatabase();
+  QSqlDatabase::removeDatabase(connectionName);
+}
+
+// File is an SQLite database
+bool SqliteStorage::IsSqlite(const QString &filename)
+{
+  if(filename.endsWith(DATABASE_SQLITE_EXTENSION, Qt::CaseInsensitive)) return(true);
+
+  QFile file(filename);
+  if(!file.open(QIODevice::ReadOnly)) return(false);
+
+  return(file.read(16) == QByteArray("SQLite format 3", 16));
+}
+
+// Open the connection and create the tables if they are not there
+bool SqliteStorage::open()
+{
+  if(database.isOpen()) return(true);
+
+  if(connectionName.isEmpty())
+  {
+    connectionName = QString("SqliteStorage-%1").arg(quintptr(this), 0, 16);
+    database = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    database.setDatabaseName(filename);
+  }
+
+  if(!database.open())
+  {
+    qDebug() << "SqliteStorage: could not open " << filename << ": " << database.lastError().text() << "\n";
+    return(false);
+  }
+
+  // Commits append to the write-ahead log rather than rewriting pages
+  QSqlQuery query(database);
+  query.exec("PRAGMA journal_mode = WAL");
+  query.exec("PRAGMA synchronous = NORMAL");
+
+  for(const char *statement : schema)
+  {
+    if(!query.exec(statement))
+    {
+      qDebug() << "SqliteStorage: could not create tables in " << filename << ": " << query.lastError().text() << "\n";
+      database.close();
+      return(false);
+    }
+  }
+
+  query.prepare("INSERT OR IGNORE INTO meta (key, value) VALUES ('version', ?)");
+  query.addBindValue(DATABASE_SQLITE_VERSION);
+
+  return(exec(query));
+}
+
+// Run a statement, logging any error
+bool SqliteStorage::exec(QSqlQuery &query)
+{
+  if(query.exec()) return(true);
+
+  qDebug() << "SqliteStorage: " << query.lastError().text() << "\n";
+  return(false);
+}
+
+// Read the database
+bool SqliteStorage::Load(QString &name, QVector<PaperMeta> *records)
+{
+  // Opening would create an empty database
+  if(!QFile::exists(filename))
+  {
+    qDebug() << "Could not open file " << filename << " for reading.\n";
+    return(false);
+  }
+
+  if(!open()) return(false);
+
+  QSqlQuery query(database);
+  query.setForwardOnly(true);
+
+  query.prepare("SELECT value FROM meta WHERE key = 'name'");
+  if(!exec(query)) return(false);
+  if(query.next()) name = query.value(0).toString();
+
+  query.prepare(QString("SELECT %1 FROM records ORDER BY citation").arg(columnList()));
+  if(!exec(query)) return(false);
+
+  while(query.next()) records->push_back(readRecord(query));
+
+  return(true);
+}
+
+// Replace the stored database with these records
+bool SqliteStorage::Save(const QString &name, QVector<PaperMeta> &records)
+{
+  if(!open()) return(false);
+
+  if(!database.transaction()) return(false);
+
+  QSqlQuery query(database);
+  bool result = query.exec("DELETE FROM records");
+
+  if(result)
+  {
+    query.prepare(QString("INSERT INTO records (%1) VALUES (%2)").arg(columnList(), placeholderList()));
+    for(int r = 0; result && (r < records.size()); r++)
+    {
+      bindRecord(query, records[r]);
+      result = exec(query);
+    }
+  }
+
+  if(result) result = writeName(name);
+
+  if(result) result = database.commit();
+  if(!result) database.rollback();
+
+  return(result);
+}
+
+// Store a record in a single transaction
+bool SqliteStorage::Upsert(const QString &key, const PaperMeta &record)
+{
+  if(!open()) return(false);
+
+  if(!database.transaction()) return(false);
+
+  // Citations are not unique, so the first record with the key is the one replaced
+  QSqlQuery query(database);
+  query.prepare(QString("UPDATE records SET %1 WHERE rowid = (SELECT rowid FROM records WHERE citation = ? LIMIT 1)").arg(assignmentList()));
+  bindRecord(query, record);
+  query.addBindValue(key);
+  bool result = exec(query);
+
+  if(result && (query.numRowsAffected() == 0))
+  {
+    query.prepare(QString("INSERT INTO records (%1) VALUES (%2)").arg(columnList(), placeholderList()));
+    bindRecord(query, record);
+    result = exec(query);
+  }
+
+  if(result) result = database.commit();
+  if(!result) database.rollback();
+
+  return(result);
+}
+
+// Remove the record with citation key
+bool SqliteStorage::Remove(const QString &key)
+{
+  if(!open()) return(false);
+
+  QSqlQuery query(database);
+  query.prepare("DELETE FROM records WHERE rowid = (SELECT rowid FROM records WHERE citation = ? LIMIT 1)");
+  query.addBindValue(key);
+
+  return(exec(query));
+}
+
+// Rename the database
+bool SqliteStorage::SetName(const QString &name)
+{
+  if(!open()) return(false);
+
+  return(writeName(name));
+}
+
+// Store the database name
+bool SqliteStorage::writeName(const QString &name)
+{
+  QSqlQuery query(database);
+  query.prepare("INSERT OR REPLACE INTO meta (key, value) VALUES ('name', ?)");
+  query.addBindValue(name);
+
+  return(exec(query));
+}
+
+// Bind the fields of a record in column order
+void SqliteStorage::bindRecord(QSqlQuery &query, const PaperMeta &record)
+{
+  query.addBindValue(record.citation);
+  query.addBindValue(record.review);
+  query.addBindValue(record.paperPath);
+  query.addBindValue(static_cast<int>(record.venue));
+  query.addBindValue(record.authors);
+  query.addBindValue(record.title);
+  query.addBindValue(record.publication);
+  query.addBindValue(record.volume);
+  query.addBindValue(record.issue);
+  query.addBindValue(record.month);
+  query.addBindValue(record.year);
+  query.addBindValue(record.dates);
+  query.addBindValue(record.pageStart);
+  query.addBindValue(record.pageEnd);
+  query.addBindValue(record.URL);
+  query.addBindValue(static_cast<int>(record.thesis));
+  query.addBindValue(record.institution);
+  query.addBindValue(record.location);
+  query.addBindValue(record.publisher);
+  query.addBindValue(record.ISBN);
+  query.addBindValue(record.doi);
+  query.addBindValue(record.note);
+  query.addBindValue(record.reviewDate.toString(Qt::ISODate));
+  query.addBindValue(record.tags);
+  query.addBindValue(record.reviewed);
+  query.addBindValue(record.reader.finished);
+  query.addBindValue(record.reader.understanding);
+  query.addBindValue(record.reader.rating);
+  query.addBindValue(static_cast<int>(record.reviewer.accept));
+  query.addBindValue(record.reviewer.suitability);
+  query.addBindValue(record.reviewer.technicalCorrectness);
+  query.addBindValue(record.reviewer.novelty);
+  query.addBindValue(record.reviewer.clarity);
+  query.addBindValue(record.reviewer.relevance);
+  query.addBindValue(record.reviewer.correctionsRequired);
+  query.addBindValue(record.reviewer.commentsToAuthors);
+  query.addBindValue(record.reviewer.commentsToChairEditor);
+}
+
+// Record from a row selected in column order
+PaperMeta SqliteStorage::readRecord(const QSqlQuery &query)
+{
+  PaperMeta record;
+
+  record.citation    = query.value(0).toString();
+  record.review      = query.value(1).toString();
+  record.paperPath   = query.value(2).toString();
+  record.venue       = static_cast<VenueType>(query.value(3).toInt());
+  record.authors     = query.value(4).toString();
+  record.title       = query.value(5).toString();
+  record.publication = query.value(6).toString();
+  record.volume      = query.value(7).toString();
+  record.issue       = query.value(8).toString();
+  record.month       = query.value(9).toString();
+  record.year        = query.value(10).toString();
+  record.dates       = query.value(11).toString();
+  record.pageStart   = query.value(12).toString();
+  record.pageEnd     = query.value(13).toString();
+  record.URL         = query.value(14).toString();
+  record.thesis      = static_cast<ThesisType>(query.value(15).toInt());
+  record.institution = query.value(16).toString();
+  record.location    = query.value(17).toString();
+  record.publisher   = query.value(18).toString();
+  record.ISBN        = query.value(19).toString();
+  record.doi         = query.value(20).toString();
+  record.note        = query.value(21).toString();
+  record.reviewDate  = QDate::fromString(query.value(22).toString(), Qt::ISODate);
+  record.tags        = query.value(23).toString();
+  record.reviewed    = query.value(24).toBool();
+
+  record.reader.finished      = query.value(25).toBool();
+  record.reader.understanding = query.value(26).toInt();
+  record.reader.rating        = query.value(27).toInt();
+
+  record.reviewer.accept                = static_cast<Acceptance>(query.value(28).toInt());
+  record.reviewer.suitability           = query.value(29).toInt();
+  record.reviewer.technicalCorrectness  = query.value(30).toInt();
+  record.reviewer.novelty               = query.value(31).toInt();
+  record.reviewer.clarity               = query.value(32).toInt();
+  record.reviewer.relevance             = query.value(33).toInt();
+  record.reviewer.correctionsRequired   = query.value(34).toBool();
+  record.reviewer.commentsToAuthors     = query.value(35).toString();
+  record.reviewer.commentsToChairEditor = query.value(36).toString();
+
+  return(record);
+}
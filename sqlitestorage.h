@@ -0,0 +1,68 @@
+/**
+ * @file   sqlitestorage.h
+ * @brief  Database stored as an SQLite file
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#ifndef SQLITESTORAGE_H
+#define SQLITESTORAGE_H
+
+#include <QSqlDatabase>
+
+#include "storagebackend.h"
+
+/// Extension of database files stored with SQLite
+#define DATABASE_SQLITE_EXTENSION ".rosqlite"
+
+/// Version of the SQLite schema
+#define DATABASE_SQLITE_VERSION "1"
+
+class QSqlQuery;
+
+/**
+ * @brief Database stored as an SQLite file
+ *
+ * Each record is a row, so a change is written as a single row transaction however large
+ * the database is. The connection belongs to the thread that created the storage, so it is
+ * not saved in the background; there is nothing to gain as every change is already in the
+ * file. Searches use the indexes the database handler keeps in memory rather than SQL.
+ */
+class SqliteStorage : public StorageBackend
+{
+public:
+  SqliteStorage(const QString &filename) : StorageBackend(filename) { }
+
+  /// Destructor, closes the connection
+  ~SqliteStorage() override;
+
+  /// File is an SQLite database, by its extension or, if it exists, its header
+  static bool IsSqlite(const QString &filename);
+
+  bool Load(QString &name, QVector<PaperMeta> *records) override;
+  bool Save(const QString &name, QVector<PaperMeta> &records) override;
+  bool Upsert(const QString &key, const PaperMeta &record) override;
+  bool Remove(const QString &key) override;
+  bool SetName(const QString &name) override;
+
+private:
+  /// Open the connection and create the tables if they are not there
+  bool open();
+
+  /// Run a statement, logging any error
+  bool exec(QSqlQuery &query);
+
+  /// Store the database name
+  bool writeName(const QString &name);
+
+  /// Bind the fields of a record in column order
+  static void bindRecord(QSqlQuery &query, const PaperMeta &record);
+
+  /// Record from a row selected in column order
+  static PaperMeta readRecord(const QSqlQuery &query);
+
+  QString      connectionName;         ///< Name of the connection, unique to this storage
+  QSqlDatabase database;               ///< Connection, valid once opened
+};
+
+#endif  // SQLITESTORAGE_H
@@ -0,0 +1,84 @@
+/**
+ * @file   storagebackend.h
+ * @brief  Interface to the storage that holds a database
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#ifndef STORAGEBACKEND_H
+#define STORAGEBACKEND_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "papermeta.h"
+
+/**
+ * @brief Storage that holds a database
+ *
+ * DatabaseHandler keeps the records in memory and passes each change to the storage as it
+ * is made. The storage either writes the change in place or keeps it apart from the main
+ * file until the next full Save().
+ */
+class StorageBackend
+{
+public:
+  /// Storage for the database in filename; nothing is opened until it is used
+  StorageBackend(const QString &filename) : filename(filename) { }
+
+  virtual ~StorageBackend() { }
+
+  Q_DISABLE_COPY(StorageBackend)
+
+  /// File the database is stored in
+  QString Filename() const { return(filename); }
+
+  /**
+   * Read the database
+   * @param name     set to the name of the database
+   * @param records  records are appended here, sorted if any stored changes were applied
+   */
+  virtual bool Load(QString &name, QVector<PaperMeta> *records) = 0;
+
+  /// Replace the stored database with these records, which may keep data for the next save
+  virtual bool Save(const QString &name, QVector<PaperMeta> &records) = 0;
+
+  /// Store a record, replacing the record with citation key if there is one
+  virtual bool Upsert(const QString &key, const PaperMeta &record) = 0;
+
+  /// Remove the record with citation key
+  virtual bool Remove(const QString &key) = 0;
+
+  /// Rename the database
+  virtual bool SetName(const QString &name) = 0;
+
+  /// Changes have been stored apart from the main file since the last full save
+  virtual bool HasChanges() const { return(false); }
+
+  /// The changes stored apart have grown enough to be folded in with a full save
+  virtual bool NeedsCompaction() const { return(false); }
+
+  /// Prepare for SaveSnapshot(); changes stored from now on are kept when it completes
+  virtual bool BeginBackgroundSave() { return(false); }
+
+  /// Write a snapshot of the database from a worker thread
+  virtual bool SaveSnapshot(const QString &name, QVector<PaperMeta> &records) { Q_UNUSED(name); Q_UNUSED(records); return(false); }
+
+  /// The background save has completed
+  virtual void EndBackgroundSave(bool result) { Q_UNUSED(result); }
+
+  /// Some records were loaded without their review, which is still held by the storage
+  virtual bool HoldsReviews() const { return(false); }
+
+  /// Review text of a record, fetched from the storage if it was not loaded
+  virtual QString ReviewText(const PaperMeta &record) const { return(record.review); }
+
+  /// Release the reviews held once they have all been fetched
+  virtual void ReleaseReviews() { }
+
+protected:
+  QString filename;                    ///< File the database is stored in
+};
+
+#endif  // STORAGEBACKEND_H
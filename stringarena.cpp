@@ -0,0 +1,96 @@
+/**
+ * @file   stringarena.cpp
+ * @brief  Large blocks that the strings of loaded records are placed in
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include <cstring>
+
+#include "stringarena.h"
+
+// Constructor
+StringArena::StringArena() :
+  block(nullptr), blockData(nullptr), used(0), capacity(0),
+  decoder(QStringDecoder::Utf8, QStringDecoder::Flag::Stateless | QStringDecoder::Flag::ConvertInitialBom)
+{
+}
+
+// Destructor
+StringArena::~StringArena()
+{
+  release();
+}
+
+// String decoded from UTF-8
+QString StringArena::FromUtf8(const char *utf8, qsizetype size)
+{
+  if(size == 0) return(QString());
+
+  // UTF-8 never decodes to more UTF-16 characters than it has bytes
+  char16_t *text = reserve(size);
+  if(!text) return(QString::fromUtf8(utf8, size));
+
+  QChar *begin = reinterpret_cast<QChar *>(text);
+  QChar *end = decoder.appendToBuffer(begin, QByteArrayView(utf8, size));
+
+  return(commit(text, end-begin));
+}
+
+// Copy of text
+QString StringArena::Copy(QStringView text)
+{
+  if(text.isEmpty()) return(QString());
+
+  char16_t *copy = reserve(text.size());
+  if(!copy) return(text.toString());
+
+  memcpy(copy, text.utf16(), text.size()*sizeof(char16_t));
+
+  return(commit(copy, text.size()));
+}
+
+// Space for length characters and a terminator in the current block
+char16_t *StringArena::reserve(qsizetype length)
+{
+  if(length > STRING_ARENA_MAX_STRING) return(nullptr);
+
+  if(!block || (used+length+1 > capacity))
+  {
+    // The rest of the block is left to the strings already placed in it
+    release();
+
+    auto allocated = QTypedArrayData<char16_t>::allocate(STRING_ARENA_BLOCK_SIZE);
+    if(!allocated.first) return(nullptr);
+
+    block     = allocated.first;
+    blockData = allocated.second;
+    capacity  = block->constAllocatedCapacity();
+  }
+
+  return(blockData+used);
+}
+
+// String of the characters placed at text
+QString StringArena::commit(char16_t *text, qsizetype length)
+{
+  // Strings are null terminated like any other QString data
+  text[length] = u'\0';
+  used = (text-blockData)+length+1;
+
+  // Each string holds a reference to the block, which is freed with the last of them
+  block->ref();
+  return(QString(QString::DataPointer(block, text, length)));
+}
+
+// Release the arena's share of the current block
+void StringArena::release()
+{
+  if(block && !block->deref())
+    QTypedArrayData<char16_t>::deallocate(block);
+
+  block     = nullptr;
+  blockData = nullptr;
+  used      = 0;
+  capacity  = 0;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file   stringarena.h
+ * @brief  Large blocks that the strings of loaded records are placed in
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#ifndef STRINGARENA_H
+#define STRINGARENA_H
+
+#include <QString>
+#include <QStringView>
+#include <QStringDecoder>
+
+/// Characters in each block of an arena
+#define STRING_ARENA_BLOCK_SIZE (128*1024)
+
+/// Strings longer than this get a buffer of their own rather than a share of a block
+#define STRING_ARENA_MAX_STRING (8*1024)
+
+/**
+ * @brief Places strings one after another in large shared blocks
+ *
+ * Loading a database creates several strings for every record, each with its own heap
+ * allocation, and replacing the database frees them one by one. Strings made by an arena
+ * are ordinary QStrings that share a reference counted block instead, so loading makes one
+ * allocation per block and a block is freed in one go once its last string is released.
+ *
+ * The strings are implicitly shared as usual: changing one copies it out of the block, so
+ * edited records move into normal storage. A string kept after the database is replaced
+ * keeps its whole block, so the arena is only used for records loaded from disk.
+ *
+ * An arena must only be used from one thread; the strings it makes may be passed between
+ * threads like any other.
+ *
+ * The blocks are made with QTypedArrayData and wrapped with QString(QString::DataPointer),
+ * which Qt 6 exposes in its headers but does not document as public API; they may change
+ * between minor releases of Qt, so check this class when Qt is upgraded.
+ */
+class StringArena
+{
+public:
+  StringArena();
+
+  /// Destructor, releases the arena's share of the current block
+  ~StringArena();
+
+  Q_DISABLE_COPY(StringArena)
+
+  /// String decoded from UTF-8, as QString::fromUtf8()
+  QString FromUtf8(const char *utf8, qsizetype size);
+
+  /// Copy of text
+  QString Copy(QStringView text);
+
+private:
+  /// Space for length characters and a terminator in the current block, or nullptr if too long
+  char16_t *reserve(qsizetype length);
+
+  /// String of the length characters at text, which was returned by reserve()
+  QString commit(char16_t *text, qsizetype length);
+
+  /// Release the arena's share of the current block
+  void release();
+
+  QTypedArrayData<char16_t> *block;    ///< Block strings are placed in, or nullptr
+  char16_t      *blockData;            ///< First character of block
+  qsizetype      used;                 ///< Characters of block in use
+  qsizetype      capacity;             ///< Characters in block
+  QStringDecoder decoder;              ///< Decodes each string independently
+};
+
+#endif  // STRINGARENA_H
@@ -0,0 +1,34 @@
+/**
+ * @file   stringpool.cpp
+ * @brief  Pool of shared strings for fields that repeat across records
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include "stringpool.h"
+
+// Replace text with the pooled copy of its value
+void StringPool::Intern(QString &text)
+{
+  if(text.isEmpty())
+  {
+    text = QString();
+    return;
+  }
+
+  QSet<QString>::const_iterator pooled = strings.constFind(text);
+  if(pooled != strings.constEnd())
+    text = *pooled;
+  else
+  {
+    text = QString(text.constData(), text.size());
+    strings.insert(text);
+  }
+}
+
+// Remove the values that no string outside the pool shares
+void StringPool::Prune()
+{
+  // A value whose buffer is not shared is only referenced by the pool itself
+  strings.removeIf([](const QString &value) { return(!value.data_ptr().isShared()); });
+}
@@ -0,0 +1,47 @@
+/**
+ * @file   stringpool.h
+ * @brief  Pool of shared strings for fields that repeat across records
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <QString>
+#include <QSet>
+
+/**
+ * @brief Interns strings so that equal values share one buffer
+ *
+ * Fields such as the publication, publisher or institution are repeated across many
+ * records. Each copy read from a file has its own buffer; interning replaces it with the
+ * pooled copy so that the text is only held once.
+ */
+class StringPool
+{
+public:
+  /**
+   * Replace text with the pooled copy of its value; empty text is made null so it holds no
+   * buffer. A value new to the pool is copied into a buffer of its own, so the pool does not
+   * keep a block of the StringArena the text may have been loaded into.
+   */
+  void Intern(QString &text);
+
+  /// Number of distinct strings in the pool
+  int Size() const { return(strings.size()); }
+
+  /// Memory used by the table of the pool; the strings are shared with the records
+  qint64 MemoryUsage() const { return(strings.capacity()*(sizeof(QString)+1)); }
+
+  /// Empty the pool; strings already interned keep their shared buffer
+  void Clear() { strings.clear(); }
+
+  /// Remove the values that no string outside the pool shares any more
+  void Prune();
+
+private:
+  QSet<QString> strings;               ///< One copy of each value
+};
+
+#endif  // STRINGPOOL_H
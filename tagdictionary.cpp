@@ -0,0 +1,136 @@
+/**
+ * @file   tagdictionary.cpp
+ * @brief  Dictionary of the tags used in a database
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include "tagdictionary.h"
+#include "memoryreport.h"
+
+// ID of a tag, added to the dictionary if it is new
+int TagDictionary::Add(const QString &tag)
+{
+  QHash<QString, int>::const_iterator found = ids.constFind(tag);
+  if(found != ids.constEnd()) return(found.value());
+
+  int id = names.size();
+  ids.insert(tag, id);
+  names.push_back(tag);
+  useCount.push_back(0);
+
+  return(id);
+}
+
+// ID of a tag
+int TagDictionary::Find(const QString &tag) const
+{
+  return(ids.value(tag, -1));
+}
+
+// Set of the tags in a comma separated list
+QBitArray TagDictionary::Encode(const QString &tags)
+{
+  QBitArray set;
+  if(tags.isEmpty()) return(set);
+
+  const QStringList tag_list = tags.split(",", Qt::SkipEmptyParts);
+  for(const QString &tag : tag_list)
+  {
+    int id = Add(tag);
+    if(id >= set.size()) set.resize(id+1);
+    set.setBit(id);
+  }
+
+  return(set);
+}
+
+// Set of the given tags
+bool TagDictionary::Lookup(const QStringList &tags, QBitArray *set) const
+{
+  bool all = true;
+  set->clear();
+
+  for(const QString &tag : tags)
+  {
+    int id = Find(tag);
+    if(id < 0)
+    {
+      all = false;
+      continue;
+    }
+
+    if(id >= set->size()) set->resize(id+1);
+    set->setBit(id);
+  }
+
+  return(all);
+}
+
+// Change the number of records using each tag in the set
+void TagDictionary::Count(const QBitArray &set, int delta)
+{
+  for(int id = 0; id < set.size(); id++)
+    if(set.testBit(id)) useCount[id] += delta;
+}
+
+// Tags used by at least one record
+QStringList TagDictionary::Tags() const
+{
+  QStringList used;
+  for(int id = 0; id < names.size(); id++)
+    if(useCount[id] > 0) used.push_back(names[id]);
+
+  used.sort();
+
+  return(used);
+}
+
+// Remove all tags
+void TagDictionary::Clear()
+{
+  ids.clear();
+  names.clear();
+  useCount.clear();
+}
+
+// Memory used by the dictionary
+qint64 TagDictionary::MemoryUsage() const
+{
+  // The keys of the hash share their text with the names
+  qint64 bytes = MemoryReport::HashBytes(ids)+names.capacity()*sizeof(QString)+useCount.capacity()*sizeof(int);
+  for(int t = 0; t < names.size(); t++) bytes += (names[t].size()+1)*sizeof(QChar);
+
+  return(bytes);
+}
+
+// Every tag of filter is in set
+bool TagDictionary::ContainsAll(const QBitArray &set, const QBitArray &filter)
+{
+  // Compare a byte at a time; bits past the end of either array are clear
+  const uchar *set_bits = reinterpret_cast<const uchar *>(set.bits());
+  const uchar *filter_bits = reinterpret_cast<const uchar *>(filter.bits());
+  qsizetype set_bytes = (set.size()+7)/8;
+  qsizetype filter_bytes = (filter.size()+7)/8;
+
+  for(qsizetype b = 0; b < filter_bytes; b++)
+  {
+    uchar bits = (b < set_bytes) ? set_bits[b] : 0;
+    if((bits & filter_bits[b]) != filter_bits[b]) return(false);
+  }
+
+  return(true);
+}
+
+// Some tag of filter is in set
+bool TagDictionary::ContainsAny(const QBitArray &set, const QBitArray &filter)
+{
+  const uchar *set_bits = reinterpret_cast<const uchar *>(set.bits());
+  const uchar *filter_bits = reinterpret_cast<const uchar *>(filter.bits());
+  qsizetype bytes = qMin((set.size()+7)/8, (filter.size()+7)/8);
+
+  for(qsizetype b = 0; b < bytes; b++)
+    if(set_bits[b] & filter_bits[b]) return(true);
+
+  return(false);
+}
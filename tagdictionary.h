@@ -0,0 +1,69 @@
+/**
+ * @file   tagdictionary.h
+ * @brief  Dictionary of the tags used in a database
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#ifndef TAGDICTIONARY_H
+#define TAGDICTIONARY_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include <QBitArray>
+
+/**
+ * @brief Gives each tag in a database an integer ID
+ *
+ * Each record keeps the set of its tag IDs as a bit array, so filtering on tags is a
+ * bitwise test rather than splitting the tag string of every record. The number of
+ * records using each tag is kept up to date as records change, so the list of tags in
+ * use does not have to be rebuilt from the records. Records still store and save their
+ * tags as a comma separated string.
+ */
+class TagDictionary
+{
+public:
+  /// ID of a tag, added to the dictionary if it is new
+  int Add(const QString &tag);
+
+  /// ID of a tag, or -1 if no record has used it
+  int Find(const QString &tag) const;
+
+  /// Set of the tags in a comma separated list, adding any new tags
+  QBitArray Encode(const QString &tags);
+
+  /**
+   * Set of the given tags
+   * @param set  set to the IDs of the tags in the dictionary
+   * @return false if any of the tags are not in the dictionary
+   */
+  bool Lookup(const QStringList &tags, QBitArray *set) const;
+
+  /// Change the number of records using each tag in the set
+  void Count(const QBitArray &set, int delta);
+
+  /// Tags used by at least one record, sorted
+  QStringList Tags() const;
+
+  /// Remove all tags
+  void Clear();
+
+  /// Memory used by the dictionary, including the text of the tags
+  qint64 MemoryUsage() const;
+
+  /// Every tag of filter is in set
+  static bool ContainsAll(const QBitArray &set, const QBitArray &filter);
+
+  /// Some tag of filter is in set
+  static bool ContainsAny(const QBitArray &set, const QBitArray &filter);
+
+private:
+  QHash<QString, int> ids;             ///< ID of each tag
+  QStringList         names;           ///< Tag of each ID
+  QVector<int>        useCount;        ///< Number of records using each ID
+};
+
+#endif  // TAGDICTIONARY_H
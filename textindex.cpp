@@ -0,0 +1,110 @@
+/**
+ * @file   textindex.cpp
+ * @brief  Inverted index of the words in a field of the records
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include <algorithm>
+
+#include <QSet>
+#include <QStringView>
+
+#include "textindex.h"
+#include "memoryreport.h"
+
+// Index the words of text for a record
+void TextIndex::Add(int id, const QString &text)
+{
+  const QStringList words = Words(text);
+  for(const QString &word : words)
+  {
+    QVector<int> &list = postings[word];
+
+    // New records have the highest ID, so most are appended
+    if(list.isEmpty() || (list.last() < id))
+      list.push_back(id);
+    else
+    {
+      QVector<int>::iterator position = std::lower_bound(list.begin(), list.end(), id);
+      if(*position != id) list.insert(position, id);
+    }
+  }
+}
+
+// Remove a record from the words of text
+void TextIndex::Remove(int id, const QString &text)
+{
+  const QStringList words = Words(text);
+  for(const QString &word : words)
+  {
+    QHash<QString, QVector<int>>::iterator found = postings.find(word);
+    if(found == postings.end()) continue;
+
+    QVector<int> &list = found.value();
+    QVector<int>::iterator position = std::lower_bound(list.begin(), list.end(), id);
+    if((position != list.end()) && (*position == id)) list.erase(position);
+
+    if(list.isEmpty()) postings.erase(found);
+  }
+}
+
+// IDs of the records containing a word
+const QVector<int> *TextIndex::Postings(const QString &word) const
+{
+  QHash<QString, QVector<int>>::const_iterator found = postings.constFind(word);
+  if(found == postings.constEnd()) return(nullptr);
+
+  return(&found.value());
+}
+
+// Memory used by the index
+qint64 TextIndex::MemoryUsage() const
+{
+  qint64 bytes = MemoryReport::HashBytes(postings);
+
+  for(QHash<QString, QVector<int>>::const_iterator p = postings.constBegin(); p != postings.constEnd(); ++p)
+    bytes += (p.key().size()+1)*sizeof(QChar)+p.value().capacity()*sizeof(int);
+
+  return(bytes);
+}
+
+// Distinct words of text
+QStringList TextIndex::Words(const QString &text)
+{
+  QSet<QString> words;
+
+  qsizetype start = -1;
+  for(qsizetype c = 0; c <= text.size(); c++)
+  {
+    bool word_character = (c < text.size()) && IsWordCharacter(text[c]);
+
+    if(word_character && (start < 0))
+      start = c;
+    else if(!word_character && (start >= 0))
+    {
+      words.insert(QStringView(text).mid(start, c-start).toString().toCaseFolded());
+      start = -1;
+    }
+  }
+
+  return(words.values());
+}
+
+// Text is words separated by single spaces
+bool TextIndex::IsPhrase(const QString &text)
+{
+  if(text.isEmpty() || (text.front() == u' ') || (text.back() == u' ')) return(false);
+
+  for(qsizetype c = 0; c < text.size(); c++)
+  {
+    if(text[c] == u' ')
+    {
+      if(text[c+1] == u' ') return(false);
+    }
+    else if(!IsWordCharacter(text[c]))
+      return(false);
+  }
+
+  return(true);
+}
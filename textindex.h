@@ -0,0 +1,61 @@
+/**
+ * @file   textindex.h
+ * @brief  Inverted index of the words in a field of the records
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+
+/**
+ * @brief Records containing each word of a field
+ *
+ * Text is split into words as a regular expression's \\b sees them, runs of letters,
+ * numbers and underscores, and the words are case folded. Each word has a posting list of
+ * the IDs of the records containing it, in ascending order, so a keyword is found without
+ * scanning the text of every record.
+ */
+class TextIndex
+{
+public:
+  /// Index the words of text for the record with ID id
+  void Add(int id, const QString &text);
+
+  /// Remove the record with ID id from the words of text, which is the text that was added
+  void Remove(int id, const QString &text);
+
+  /// IDs of the records containing a word, in ascending order, or nullptr if there are none
+  const QVector<int> *Postings(const QString &word) const;
+
+  /// Remove all words
+  void Clear() { postings.clear(); }
+
+  /// Number of distinct words
+  int Size() const { return(postings.size()); }
+
+  /// Memory used by the index, including the text of the words
+  qint64 MemoryUsage() const;
+
+  /// Distinct words of text, case folded
+  static QStringList Words(const QString &text);
+
+  /// Text is made of words separated by single spaces, so it can be found as a phrase of words
+  static bool IsPhrase(const QString &text);
+
+  /// Character is part of a word
+  static bool IsWordCharacter(QChar c)
+  {
+    return(c.isLetterOrNumber() || c.isMark() || (c == u'_'));
+  }
+
+private:
+  QHash<QString, QVector<int>> postings;  ///< IDs of the records containing each word
+};
+
+#endif  // TEXTINDEX_H
@@ -0,0 +1,380 @@
+/**
+ * @file   xmlstorage.cpp
+ * @brief  Database stored as an XML file with a journal of changes
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#include <algorithm>
+
+#include <QThread>
+#include <QHash>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include "xmlstorage.h"
+#include "databasefilereader.h"
+#include "databasefilewriter.h"
+#include "gzipdevice.h"
+#include "performancelog.h"
+
+// Destructor
+XmlStorage::~XmlStorage()
+{
+  ReleaseReviews();
+}
+
+// Read the database file and replay its journal
+bool XmlStorage::Load(QString &name, QVector<PaperMeta> *records)
+{
+  // With lazy reviews the file stays open and mapped while the database is in use
+  QFile local_input;
+  QFile &input = lazyReviews ? reviewSource : local_input;
+  input.setFileName(filename);
+
+  if(!input.open(QIODevice::ReadOnly))
+  {
+    qDebug() << "Could not open file " << filename << " for reading.\n";
+    return(false);
+  }
+
+  int initial_size = records->size();
+  bool result = false;
+
+  QElapsedTimer load_timer;
+  load_timer.start();
+
+  // Compressed files are decompressed as they are streamed, so reviews are always loaded
+  bool compressed = GzipDevice::IsCompressed(&input);
+  bool lazy = lazyReviews && !compressed;
+
+  DatabaseFileStamp stamp;
+  bool stamped = false;
+  QString cache_file = DatabaseCache::CacheFilename(filename);
+
+  // Parse straight out of the mapped file; nothing is copied or decoded except the fields kept
+  uchar *mapped = nullptr;
+  if(input.size() > 0) mapped = input.map(0, input.size());
+
+  if(mapped)
+  {
+    const char *data = reinterpret_cast<const char *>(mapped);
+
+    // A valid cache saves parsing the file at all
+    stamp = fileStamp(input, data);
+    stamped = true;
+
+    if(useCache && !lazy && DatabaseCache::Read(cache_file, stamp, name, records))
+      result = true;
+    else if(!compressed)
+    {
+      DatabaseFileReader mapped_reader;
+      mapped_reader.SetLazyReviews(lazy);
+
+      // Large files are divided between the available cores
+      int threads = QThread::idealThreadCount();
+      if(parallelLoad && (threads > 1) && (input.size() >= PARALLEL_LOAD_MIN_SIZE))
+      {
+        int shards = qMin<qint64>(threads*PARALLEL_LOAD_SHARDS_PER_THREAD, input.size()/PARALLEL_LOAD_MIN_SHARD_SIZE);
+        result = mapped_reader.ReadMappedParallel(data, input.size(), name, records, shards);
+      }
+      else
+        result = mapped_reader.ReadMapped(data, input.size(), name, records);
+
+      // The cache is written with the reviews, so not while they are left in the file
+      if(!result)
+        qDebug() << "XmlStorage: mapped read failed, reading as stream\n";
+      else if(useCache && !lazy && (initial_size == 0))
+      {
+        if(!DatabaseCache::Write(cache_file, stamp, name, *records))
+          qDebug() << "XmlStorage: could not write cache " << cache_file << "\n";
+      }
+    }
+
+    // Keep the mapping to fetch reviews from
+    if(result && lazy)
+      reviewMap = mapped;
+    else
+      input.unmap(mapped);
+  }
+
+  // Stream compressed files, and fall back to the stream reader if the file could not be mapped or parsed
+  if(!result)
+  {
+    records->resize(initial_size);
+    input.seek(0);
+
+    DatabaseFileReader reader;
+    result = reader.Read(&input, name, records);
+
+    // A cache saves decompressing or parsing the file next time
+    if(result && stamped && useCache && (initial_size == 0))
+    {
+      if(!DatabaseCache::Write(cache_file, stamp, name, *records))
+        qDebug() << "XmlStorage: could not write cache " << cache_file << "\n";
+    }
+  }
+
+  if(!reviewMap) input.close();
+
+  if(result)
+  {
+    // Parse throughput, to compare readers and file formats
+    qint64 elapsed = qMax<qint64>(load_timer.elapsed(), 1);
+    qCDebug(performanceLog) << "XmlStorage: read" << (records->size()-initial_size) << "records," << input.size() << "bytes in"
+             << elapsed << "ms," << (input.size()/1024.0/1024.0)/(elapsed/1000.0) << "MB/s";
+
+    // Changes made since the file was last written
+    journal.Open(filename);
+    replayJournal(name, records);
+  }
+
+  return(result);
+}
+
+// Write the whole database; the journal's changes are then in the file
+bool XmlStorage::Save(const QString &name, QVector<PaperMeta> &records)
+{
+  if(!writeFile(name, records)) return(false);
+
+  // Changes are journaled against the file from now on
+  journal.Open(filename);
+  journal.Clear();
+
+  return(true);
+}
+
+// Write the file and its cache
+bool XmlStorage::writeFile(const QString &name, QVector<PaperMeta> &records)
+{
+  // Version 1 records are written field by field, only version 2 records are kept encoded
+  DatabaseFileWriter writer;
+  if(compactFormat)
+    encodeRecords(records);
+  else
+    writer.version = DATABASE_VERSION_COMPATIBLE;
+
+  if(!writer.Save(filename, name, records)) return(false);
+
+  if(useCache) updateCache(filename, name, records);
+
+  return(true);
+}
+
+// Journal a new or changed record
+bool XmlStorage::Upsert(const QString &key, const PaperMeta &record)
+{
+  DatabaseChange change;
+  change.type = (key == record.citation) ? ChangeType::Edit : ChangeType::Rename;
+  change.key = key;
+  change.record = record;
+
+  return(journalChange(change));
+}
+
+// Journal the removal of a record
+bool XmlStorage::Remove(const QString &key)
+{
+  DatabaseChange change;
+  change.type = ChangeType::Delete;
+  change.key = key;
+
+  return(journalChange(change));
+}
+
+// Journal a new database name
+bool XmlStorage::SetName(const QString &name)
+{
+  DatabaseChange change;
+  change.type = ChangeType::Name;
+  change.name = name;
+
+  return(journalChange(change));
+}
+
+// Append a change to the journal
+bool XmlStorage::journalChange(const DatabaseChange &change)
+{
+  // Nothing is journaled until the file has been read or written
+  if(!journal.IsOpen()) return(false);
+
+  return(journal.Append(change));
+}
+
+// Changes are in the journal
+bool XmlStorage::HasChanges() const
+{
+  return(journal.IsOpen() && (journal.Size() > 0));
+}
+
+// Fold the journal into the file once it has grown
+bool XmlStorage::NeedsCompaction() const
+{
+  return(journal.IsOpen() && (journal.Size() >= JOURNAL_COMPACT_SIZE));
+}
+
+// Changes from here on go to a new journal so that they outlive the save
+bool XmlStorage::BeginBackgroundSave()
+{
+  // A journal next to a file that has not been read is stale
+  if(!journal.IsOpen())
+  {
+    journal.Open(filename);
+    journal.Clear();
+    return(true);
+  }
+
+  if(!journal.SetPending())
+  {
+    qDebug() << "XmlStorage: could not set the journal aside for a background save\n";
+    return(false);
+  }
+
+  return(true);
+}
+
+// Write the file from a worker thread
+bool XmlStorage::SaveSnapshot(const QString &name, QVector<PaperMeta> &records)
+{
+  return(writeFile(name, records));
+}
+
+// Changes made during the save are still in the journal
+void XmlStorage::EndBackgroundSave(bool result)
+{
+  // After a failure the pending changes are replayed until the next full save
+  if(result) journal.ClearPending();
+}
+
+// Apply the changes in the journal to the loaded records
+bool XmlStorage::replayJournal(QString &name, QVector<PaperMeta> *records)
+{
+  QVector<DatabaseChange> changes;
+  if(!journal.Read(&changes) || changes.isEmpty()) return(false);
+
+  // Records are found by citation key once each, and deleted ones are only marked until
+  // all the changes are applied, so a long journal does not scan the records per change
+  QHash<QString, int> positions;
+  positions.reserve(records->size() + changes.size());
+  for(int r = 0; r < records->size(); r++)
+    positions.insert(records->at(r).citation, r);
+
+  QSet<int> deleted;
+
+  for(int c = 0; c < changes.size(); c++)
+  {
+    const DatabaseChange &change = changes[c];
+
+    if(change.type == ChangeType::Name)
+    {
+      name = change.name;
+      continue;
+    }
+
+    // Replaying is idempotent: a rename may already be in the file, and the old key may
+    // since have been reused by a later change
+    int index = -1;
+    if(change.type == ChangeType::Rename)
+      index = positions.value(change.record.citation, -1);
+    if(index < 0)
+      index = positions.value(change.key, -1);
+
+    if(change.type == ChangeType::Delete)
+    {
+      if(index >= 0)
+      {
+        positions.remove(records->at(index).citation);
+        deleted.insert(index);
+      }
+    }
+    else if(index >= 0)
+    {
+      if(records->at(index).citation != change.record.citation)
+      {
+        positions.remove(records->at(index).citation);
+        positions.insert(change.record.citation, index);
+      }
+      (*records)[index] = change.record;
+    }
+    else
+    {
+      positions.insert(change.record.citation, records->size());
+      records->push_back(change.record);
+    }
+  }
+
+  if(!deleted.isEmpty())
+  {
+    int kept = 0;
+    for(int r = 0; r < records->size(); r++)
+    {
+      if(deleted.contains(r)) continue;
+      if(kept != r) (*records)[kept] = std::move((*records)[r]);
+      kept++;
+    }
+    records->resize(kept);
+  }
+
+  qCDebug(performanceLog) << "XmlStorage: replayed" << changes.size() << "changes from the journal";
+
+  std::sort(records->begin(), records->end());
+
+  return(true);
+}
+
+// Rewrite the cache to match the database file
+void XmlStorage::updateCache(const QString &filename, const QString &name, const QVector<PaperMeta> &records)
+{
+  QFile saved(filename);
+  if(!saved.open(QIODevice::ReadOnly) || (saved.size() == 0)) return;
+
+  // The records come from memory; only the pages the stamp hashes are read back
+  uchar *mapped = saved.map(0, saved.size());
+  if(!mapped) return;
+
+  DatabaseFileStamp stamp = fileStamp(saved, reinterpret_cast<const char *>(mapped));
+  saved.unmap(mapped);
+
+  if(!DatabaseCache::Write(DatabaseCache::CacheFilename(filename), stamp, name, records))
+    qDebug() << "XmlStorage: could not write cache for " << filename << "\n";
+}
+
+// Encode the records that changed since they were last saved
+void XmlStorage::encodeRecords(QVector<PaperMeta> &records)
+{
+  // Records that have not changed keep their encoding from the last save
+  for(int r = 0; r < records.size(); r++)
+  {
+    if(records[r].xmlFragment.isEmpty())
+      records[r].xmlFragment = DatabaseFileWriter::EncodeRecord(records[r]);
+  }
+}
+
+// Stamp identifying the current contents of a database file
+DatabaseFileStamp XmlStorage::fileStamp(const QFile &file, const char *data)
+{
+  DatabaseFileStamp stamp;
+  stamp.size     = file.size();
+  stamp.modified = file.fileTime(QFileDevice::FileModificationTime).toMSecsSinceEpoch();
+  stamp.hash     = DatabaseCache::Hash(data, stamp.size);
+
+  return(stamp);
+}
+
+// Review text of a record, decoded from the file if it was not loaded
+QString XmlStorage::ReviewText(const PaperMeta &record) const
+{
+  if(record.ReviewLoaded() || !reviewMap) return(record.review);
+
+  const char *begin = reinterpret_cast<const char *>(reviewMap)+record.reviewOffset;
+  return(DatabaseFileReader::DecodeText(begin, begin+record.reviewLength));
+}
+
+// Unmap and close the file reviews are fetched from
+void XmlStorage::ReleaseReviews()
+{
+  if(reviewMap) reviewSource.unmap(reviewMap);
+  reviewMap = nullptr;
+  reviewSource.close();
+}
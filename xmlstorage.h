@@ -0,0 +1,88 @@
+/**
+ * @file   xmlstorage.h
+ * @brief  Database stored as an XML file with a journal of changes
+ * @author Lyndon Hill
+ * @date   2026.10.17
+ */
+
+#ifndef XMLSTORAGE_H
+#define XMLSTORAGE_H
+
+#include <QFile>
+
+#include "storagebackend.h"
+#include "databasecache.h"
+#include "databasejournal.h"
+
+/// Files smaller than this are always read on one thread
+#define PARALLEL_LOAD_MIN_SIZE (4*1024*1024)
+
+/// Smallest shard of records handed to a thread when loading in parallel
+#define PARALLEL_LOAD_MIN_SHARD_SIZE (256*1024)
+
+/// Shards per core, so a shard of long reviews does not hold up the load
+#define PARALLEL_LOAD_SHARDS_PER_THREAD 4
+
+/**
+ * @brief Database stored as an XML file, optionally gzip compressed
+ *
+ * Changes are appended to the journal next to the file and folded into it by a full save,
+ * which writes every record again.
+ */
+class XmlStorage : public StorageBackend
+{
+public:
+  XmlStorage(const QString &filename, bool parallel_load, bool use_cache, bool lazy_reviews, bool compact_format) :
+    StorageBackend(filename), parallelLoad(parallel_load), useCache(use_cache), lazyReviews(lazy_reviews),
+    compactFormat(compact_format), reviewMap(nullptr) { }
+
+  /// Destructor, releases the file reviews are fetched from
+  ~XmlStorage() override;
+
+  bool Load(QString &name, QVector<PaperMeta> *records) override;
+  bool Save(const QString &name, QVector<PaperMeta> &records) override;
+  bool Upsert(const QString &key, const PaperMeta &record) override;
+  bool Remove(const QString &key) override;
+  bool SetName(const QString &name) override;
+
+  bool HasChanges() const override;
+  bool NeedsCompaction() const override;
+
+  bool BeginBackgroundSave() override;
+  bool SaveSnapshot(const QString &name, QVector<PaperMeta> &records) override;
+  void EndBackgroundSave(bool result) override;
+
+  bool HoldsReviews() const override { return(reviewMap != nullptr); }
+  QString ReviewText(const PaperMeta &record) const override;
+  void ReleaseReviews() override;
+
+private:
+  /// Write the file and its cache; the journal is left alone
+  bool writeFile(const QString &name, QVector<PaperMeta> &records);
+
+  /// Append a change to the journal
+  bool journalChange(const DatabaseChange &change);
+
+  /// Apply the changes in the journal to the loaded records, returns true if any were applied
+  bool replayJournal(QString &name, QVector<PaperMeta> *records);
+
+  /// Rewrite the cache to match the database file
+  static void updateCache(const QString &filename, const QString &name, const QVector<PaperMeta> &records);
+
+  /// Encode the records that changed since they were last saved
+  static void encodeRecords(QVector<PaperMeta> &records);
+
+  /// Stamp identifying the current contents of a database file
+  static DatabaseFileStamp fileStamp(const QFile &file, const char *data);
+
+  bool            parallelLoad;        ///< Parse large files on all cores
+  bool            useCache;            ///< Keep a binary cache next to the database file
+  bool            lazyReviews;         ///< Leave review text in the file until it is needed
+  bool            compactFormat;       ///< Write the version 2 format, which older programs cannot read
+
+  DatabaseJournal journal;             ///< Changes made since the file was last written
+  QFile           reviewSource;        ///< Database file that reviews are fetched from
+  uchar          *reviewMap;           ///< Mapping of reviewSource while reviews are not loaded
+};
+
+#endif  // XMLSTORAGE_H